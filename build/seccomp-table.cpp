@@ -0,0 +1,37 @@
+// Print the seccomp filter declared in FILTER (a header defining a constexpr
+// seccomp_filter() returning a seccompc::filter, see seccomp.hpp) as a table
+// of sock_filter initializers (as bpf_asm -c does) for seccomp.c to include.
+//
+// usage: seccomp-table [--nr|--args]
+
+#include <cstdio>
+#include <cstring>
+
+#include "seccomp.hpp"
+
+#include FILTER
+
+template<auto F, seccompc::half h>
+static void print()
+{
+    constexpr auto p = seccompc::assemble<F, h>();
+    std::printf("/** generated from %s: %zu instructions **/\n", FILTER, p.size());
+    for(const auto& i : p) {
+        std::printf("{ 0x%02x, %u, %u, 0x%08x },\n", i.code, i.jt, i.jf, i.k);
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    if(argc == 1) {
+        print<seccomp_filter, seccompc::half::whole>();
+    } else if(argc == 2 && strcmp(argv[1], "--nr") == 0) {
+        print<seccomp_filter, seccompc::half::nr>();
+    } else if(argc == 2 && strcmp(argv[1], "--args") == 0) {
+        print<seccomp_filter, seccompc::half::args>();
+    } else {
+        std::fprintf(stderr, "usage: %s [--nr|--args]\n", argv[0]);
+        return 2;
+    }
+    return 0;
+}
@@ -1,13 +1,48 @@
 #include <linux/seccomp.h>
 #include <linux/filter.h>
 
+// SECCOMP_SPLIT: install the filter as a stack of an argument-free filter and
+// one checking the arguments of the few syscalls that need it (see bpf-split)
+#ifndef SECCOMP_SPLIT
+#define SECCOMP_SPLIT 0
+#endif
+
+// SECCOMP_SPEC_ALLOW: don't have the kernel force its speculative execution
+// mitigations (e.g. SSBD) on the filtered process
+#ifndef SECCOMP_SPEC_ALLOW
+#define SECCOMP_SPEC_ALLOW 0
+#endif
+
+#if SECCOMP_SPEC_ALLOW
+#define SECCOMP_FILTER_FLAGS SECCOMP_FILTER_FLAG_SPEC_ALLOW
+#else
+#define SECCOMP_FILTER_FLAGS 0
+#endif
+
+static void seccomp_install(struct sock_filter* filter, unsigned short len)
+{
+    struct sock_fprog p = { .len = len, .filter = filter };
+    int r = seccomp(SECCOMP_SET_MODE_FILTER, SECCOMP_FILTER_FLAGS, &p);
+    CHECK(r, "seccomp(SECCOMP_SET_MODE_FILTER)");
+}
+
 void seccomp_apply_filter()
 {
+#if SECCOMP_SPLIT
+    // NB: the argument filter allows seccomp(2), so it goes first
+    struct sock_filter args[] = {
+#include "filter.args.bpfc"
+    };
+    seccomp_install(args, LENGTH(args));
+
+    struct sock_filter nr[] = {
+#include "filter.nr.bpfc"
+    };
+    seccomp_install(nr, LENGTH(nr));
+#else
     struct sock_filter filter[] = {
 #include "filter.bpfc"
     };
-
-    struct sock_fprog p = { .len = LENGTH(filter), .filter = filter };
-    int r = seccomp(SECCOMP_SET_MODE_FILTER, 0, &p);
-    CHECK(r, "seccomp(SECCOMP_SET_MODE_FILTER)");
+    seccomp_install(filter, LENGTH(filter));
+#endif
 }
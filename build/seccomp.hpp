@@ -0,0 +1,559 @@
+// Compile-time seccomp filters: the allowlist and the arguments' predicates
+// are declared in C++, checked by the compiler and compiled into a classic BPF
+// program: a binary search tree on the syscall number (as made by bpf-tree)
+// with the adjacent syscalls sharing an action merged into ranges.
+//
+//   constexpr seccompc::filter example()
+//   {
+//       using namespace seccompc;
+//       return filter(AUDIT_ARCH_X86_64, ret::kill_thread,
+//           allow(__NR_read, __NR_write, __NR_exit_group),
+//           allow_if(__NR_fcntl, arg(1) == F_GETFL || arg(1) == F_GETFD),
+//           rule(__NR_clone3, ret::err(ENOSYS)));
+//   }
+//
+//   auto f = seccompc::assemble<example>(); // std::array<sock_filter, N>
+//
+// The C hosts include the programs as tables printed by seccomp-table.cpp.
+//
+// NB: the predicates compare the lower 32 bits of the arguments (as do the
+// filters written for bpf_asm)
+
+#ifndef SECCOMP_HPP
+#define SECCOMP_HPP
+
+#include <linux/audit.h>
+#include <linux/filter.h>
+#include <linux/seccomp.h>
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+
+namespace seccompc {
+
+constexpr std::size_t max_atoms = 4; // comparisons per conjunction
+constexpr std::size_t max_terms = 8; // conjunctions per predicate
+constexpr std::size_t max_rules = 256;
+constexpr std::size_t max_jump = 255; // conditional jumps' offsets are 8 bits
+constexpr std::size_t linear_max = 3; // emit chains of at most this many jeq:s
+constexpr std::uint64_t nr_max = std::uint64_t(1) << 32;
+
+struct action {
+    std::uint32_t ret;
+    constexpr bool operator==(const action&) const = default;
+};
+
+namespace ret {
+constexpr action allow { SECCOMP_RET_ALLOW };
+constexpr action log { SECCOMP_RET_LOG };
+constexpr action kill_thread { SECCOMP_RET_KILL_THREAD };
+constexpr action kill_process { SECCOMP_RET_KILL_PROCESS };
+
+constexpr action err(int e)
+{
+    return { SECCOMP_RET_ERRNO | (std::uint32_t(e) & SECCOMP_RET_DATA) };
+}
+}
+
+enum class op : std::uint8_t { eq, ne, gt, le, ge, lt, set, clear };
+
+constexpr op negate(op o)
+{
+    switch(o) {
+    case op::eq: return op::ne;
+    case op::ne: return op::eq;
+    case op::gt: return op::le;
+    case op::le: return op::gt;
+    case op::ge: return op::lt;
+    case op::lt: return op::ge;
+    case op::set: return op::clear;
+    case op::clear: return op::set;
+    }
+    throw "seccomp: unknown comparison";
+}
+
+struct atom {
+    std::uint8_t arg;
+    op o;
+    std::uint32_t k;
+    constexpr bool operator==(const atom&) const = default;
+};
+
+struct term {
+    atom atoms[max_atoms] {};
+    std::size_t n = 0;
+    constexpr bool operator==(const term&) const = default;
+};
+
+// in disjunctive normal form: an empty predicate is false, an empty term true
+struct predicate {
+    term terms[max_terms] {};
+    std::size_t n = 0;
+
+    constexpr predicate() = default;
+    constexpr predicate(atom a) : n(1)
+    {
+        terms[0].atoms[0] = a;
+        terms[0].n = 1;
+    }
+
+    constexpr void push(const term& t)
+    {
+        if(n == max_terms) throw "seccomp: too many alternatives (see max_terms)";
+        terms[n++] = t;
+    }
+
+    constexpr bool operator==(const predicate&) const = default;
+};
+
+constexpr predicate operator||(const predicate& a, const predicate& b)
+{
+    predicate p = a;
+    for(std::size_t i = 0; i < b.n; i++) {
+        p.push(b.terms[i]);
+    }
+    return p;
+}
+
+constexpr predicate operator&&(const predicate& a, const predicate& b)
+{
+    predicate p;
+    for(std::size_t i = 0; i < a.n; i++) {
+        for(std::size_t j = 0; j < b.n; j++) {
+            term t = a.terms[i];
+            for(std::size_t k = 0; k < b.terms[j].n; k++) {
+                if(t.n == max_atoms) throw "seccomp: too many comparisons (see max_atoms)";
+                t.atoms[t.n++] = b.terms[j].atoms[k];
+            }
+            p.push(t);
+        }
+    }
+    return p;
+}
+
+constexpr predicate operator!(const predicate& a)
+{
+    predicate p;
+    p.push(term {});
+    for(std::size_t i = 0; i < a.n; i++) {
+        predicate q;
+        for(std::size_t j = 0; j < a.terms[i].n; j++) {
+            atom x = a.terms[i].atoms[j];
+            q = q || atom { x.arg, negate(x.o), x.k };
+        }
+        p = p && q;
+    }
+    return p;
+}
+
+struct argument {
+    std::uint8_t i;
+
+    constexpr predicate operator==(std::uint32_t k) const { return atom { i, op::eq, k }; }
+    constexpr predicate operator!=(std::uint32_t k) const { return atom { i, op::ne, k }; }
+    constexpr predicate operator>(std::uint32_t k) const { return atom { i, op::gt, k }; }
+    constexpr predicate operator<=(std::uint32_t k) const { return atom { i, op::le, k }; }
+    constexpr predicate operator>=(std::uint32_t k) const { return atom { i, op::ge, k }; }
+    constexpr predicate operator<(std::uint32_t k) const { return atom { i, op::lt, k }; }
+
+    // any of the bits in mask are set
+    constexpr predicate operator&(std::uint32_t mask) const { return atom { i, op::set, mask }; }
+};
+
+constexpr argument arg(unsigned int i)
+{
+    if(i >= 6) throw "seccomp: syscalls take at most six arguments";
+    return { std::uint8_t(i) };
+}
+
+struct syscalls {
+    std::uint32_t nrs[max_rules] {};
+    std::size_t n = 0;
+
+    constexpr syscalls(long nr) : n(1) { nrs[0] = std::uint32_t(nr); }
+    constexpr syscalls(std::initializer_list<long> l)
+    {
+        for(long nr : l) {
+            if(n == max_rules) throw "seccomp: too many rules (see max_rules)";
+            nrs[n++] = std::uint32_t(nr);
+        }
+    }
+};
+
+struct rule_t {
+    std::uint32_t nr;
+    bool conditional;
+    predicate p;
+    action then;
+    action otherwise;
+    bool fallthrough; // otherwise: the filter's fall through action
+};
+
+struct rules {
+    rule_t r[max_rules] {};
+    std::size_t n = 0;
+
+    constexpr rules() = default;
+    constexpr rules(const syscalls& s, const rule_t& x)
+    {
+        for(std::size_t i = 0; i < s.n; i++) {
+            push(x);
+            r[n - 1].nr = s.nrs[i];
+        }
+    }
+
+    constexpr void push(const rule_t& x)
+    {
+        if(n == max_rules) throw "seccomp: too many rules (see max_rules)";
+        r[n++] = x;
+    }
+};
+
+template<typename... T>
+constexpr rules allow(T... nrs)
+{
+    return rules({ long(nrs)... }, rule_t { .then = ret::allow });
+}
+
+constexpr rules allow_if(const syscalls& s, const predicate& p)
+{
+    return rules(s, rule_t { .conditional = true, .p = p,
+        .then = ret::allow, .fallthrough = true });
+}
+
+constexpr rules rule(const syscalls& s, action a)
+{
+    return rules(s, rule_t { .then = a });
+}
+
+constexpr rules rule(const syscalls& s, const predicate& p, action then)
+{
+    return rules(s, rule_t { .conditional = true, .p = p,
+        .then = then, .fallthrough = true });
+}
+
+constexpr rules rule(const syscalls& s, const predicate& p, action then, action otherwise)
+{
+    return rules(s, rule_t { .conditional = true, .p = p,
+        .then = then, .otherwise = otherwise });
+}
+
+// syscalls of another architecture are killed and the ones without a rule
+// get the fall through action
+struct filter {
+    std::uint32_t arch;
+    action fallthrough;
+    rules rs;
+
+    template<typename... R>
+    constexpr filter(std::uint32_t arch, action fallthrough, const R&... parts)
+        : arch(arch), fallthrough(fallthrough)
+    {
+        (add(parts), ...);
+        std::sort(rs.r, rs.r + rs.n, [](const rule_t& a, const rule_t& b) { return a.nr < b.nr; });
+        for(std::size_t i = 1; i < rs.n; i++) {
+            if(rs.r[i - 1].nr == rs.r[i].nr) throw "seccomp: duplicate rule";
+        }
+    }
+
+    constexpr void add(const rules& x)
+    {
+        for(std::size_t i = 0; i < x.n; i++) {
+            rule_t r = x.r[i];
+            if(r.fallthrough) {
+                r.otherwise = fallthrough;
+                r.fallthrough = false;
+            }
+            rs.push(r);
+        }
+    }
+};
+
+// the halves of a split filter (see bpf-split and SECCOMP_SPLIT): the
+// argument-free one allows the syscalls with conditional rules, deferring to
+// the argument-checking one which allows everything else
+enum class half { whole, nr, args };
+
+constexpr filter split(filter f, half h)
+{
+    if(h == half::whole) return f;
+
+    rules rs;
+    for(std::size_t i = 0; i < f.rs.n; i++) {
+        rule_t r = f.rs.r[i];
+        if(h == half::nr && r.conditional) {
+            rs.push(rule_t { .nr = r.nr, .then = ret::allow });
+        } else if(h == half::nr || r.conditional) {
+            rs.push(r);
+        }
+    }
+
+    f.rs = rs;
+    if(h == half::args) f.fallthrough = ret::allow;
+    return f;
+}
+
+struct program {
+    sock_filter insns[BPF_MAXINSNS] {};
+    std::size_t len = 0;
+
+    constexpr void push(std::uint16_t code, std::uint32_t k,
+                        std::size_t jt = 0, std::size_t jf = 0)
+    {
+        if(len == BPF_MAXINSNS) throw "seccomp: too many instructions";
+        if(jt > max_jump || jf > max_jump) throw "seccomp: jump out of range";
+        insns[len++] = sock_filter { code, std::uint8_t(jt), std::uint8_t(jf), k };
+    }
+};
+
+namespace detail {
+
+constexpr std::uint32_t arg_offset(std::uint8_t i)
+{
+    std::uint32_t o = offsetof(struct seccomp_data, args) + 8 * i;
+    return std::endian::native == std::endian::little ? o : o + 4;
+}
+
+// intervals [lo, next lo) of syscall numbers sharing a rule (or an action)
+struct interval {
+    std::uint64_t lo;
+    const rule_t* r; // nullptr: a plain action
+    action a;
+};
+
+class compiler {
+public:
+    constexpr compiler(const filter& f) : f(f)
+    {
+        std::uint64_t lo = 0;
+        for(std::size_t i = 0; i < f.rs.n; i++) {
+            const rule_t& r = f.rs.r[i];
+            if(r.nr > lo) push(lo, nullptr, f.fallthrough);
+            if(r.conditional) push(r.nr, &r, {});
+            else push(r.nr, nullptr, r.then);
+            lo = std::uint64_t(r.nr) + 1;
+        }
+        if(lo < nr_max) push(lo, nullptr, f.fallthrough);
+    }
+
+    constexpr program compile()
+    {
+        program p;
+        p.push(BPF_LD|BPF_W|BPF_ABS, offsetof(struct seccomp_data, arch));
+        p.push(BPF_JMP|BPF_JEQ|BPF_K, f.arch, 1, 0);
+        p.push(BPF_RET|BPF_K, SECCOMP_RET_KILL_THREAD);
+        p.push(BPF_LD|BPF_W|BPF_ABS, offsetof(struct seccomp_data, nr));
+        node(p, 0, n - 1);
+        return p;
+    }
+
+private:
+    const filter& f;
+    interval iv[2 * max_rules + 1] {};
+    std::size_t n = 0;
+
+    constexpr void push(std::uint64_t lo, const rule_t* r, action a)
+    {
+        if(n > 0 && r == nullptr && iv[n - 1].r == nullptr && iv[n - 1].a == a) {
+            return;
+        }
+        iv[n++] = { lo, r, a };
+    }
+
+    constexpr std::uint64_t hi(std::size_t i) const
+    {
+        return i + 1 < n ? iv[i + 1].lo : nr_max;
+    }
+
+    // the comparisons of a term failing leave their argument loaded for
+    // the next term
+    static constexpr bool load(const predicate& p, std::size_t t, std::size_t j)
+    {
+        const term& x = p.terms[t];
+        if(j > 0) return x.atoms[j].arg != x.atoms[j - 1].arg;
+        if(t == 0 || p.terms[t - 1].n == 0) return true;
+
+        for(std::size_t k = 0; k < p.terms[t - 1].n; k++) {
+            if(p.terms[t - 1].atoms[k].arg != x.atoms[0].arg) return true;
+        }
+        return false;
+    }
+
+    static constexpr std::size_t term_size(const predicate& p, std::size_t t)
+    {
+        std::size_t s = 1;
+        for(std::size_t j = 0; j < p.terms[t].n; j++) {
+            s += load(p, t, j) ? 2 : 1;
+        }
+        return s;
+    }
+
+    constexpr std::size_t leaf_size(std::size_t i) const
+    {
+        if(iv[i].r == nullptr) return 1;
+
+        std::size_t s = 1;
+        for(std::size_t t = 0; t < iv[i].r->p.n; t++) {
+            s += term_size(iv[i].r->p, t);
+        }
+        return s;
+    }
+
+    // a term's comparisons jump to the next term when they fail
+    constexpr void leaf(program& p, std::size_t i) const
+    {
+        const rule_t* r = iv[i].r;
+        if(r == nullptr) {
+            p.push(BPF_RET|BPF_K, iv[i].a.ret);
+            return;
+        }
+
+        for(std::size_t t = 0; t < r->p.n; t++) {
+            const term& x = r->p.terms[t];
+            std::size_t left = term_size(r->p, t);
+            for(std::size_t j = 0; j < x.n; j++) {
+                const atom& a = x.atoms[j];
+                if(load(r->p, t, j)) {
+                    p.push(BPF_LD|BPF_W|BPF_ABS, arg_offset(a.arg));
+                    left -= 1;
+                }
+                left -= 1;
+                switch(a.o) {
+                case op::eq: p.push(BPF_JMP|BPF_JEQ|BPF_K, a.k, 0, left); break;
+                case op::ne: p.push(BPF_JMP|BPF_JEQ|BPF_K, a.k, left, 0); break;
+                case op::gt: p.push(BPF_JMP|BPF_JGT|BPF_K, a.k, 0, left); break;
+                case op::le: p.push(BPF_JMP|BPF_JGT|BPF_K, a.k, left, 0); break;
+                case op::ge: p.push(BPF_JMP|BPF_JGE|BPF_K, a.k, 0, left); break;
+                case op::lt: p.push(BPF_JMP|BPF_JGE|BPF_K, a.k, left, 0); break;
+                case op::set: p.push(BPF_JMP|BPF_JSET|BPF_K, a.k, 0, left); break;
+                case op::clear: p.push(BPF_JMP|BPF_JSET|BPF_K, a.k, left, 0); break;
+                }
+            }
+            p.push(BPF_RET|BPF_K, r->then.ret);
+        }
+        p.push(BPF_RET|BPF_K, r->otherwise.ret);
+    }
+
+    constexpr bool special(std::size_t k) const
+    {
+        return iv[k].r != nullptr || iv[k].a != f.fallthrough;
+    }
+
+    constexpr bool same(std::size_t a, std::size_t b) const
+    {
+        const rule_t* x = iv[a].r;
+        const rule_t* y = iv[b].r;
+        if(x == nullptr || y == nullptr) return x == y && iv[a].a == iv[b].a;
+        return x->p == y->p && x->then == y->then && x->otherwise == y->otherwise;
+    }
+
+    // a few single syscalls in a sea of fall through: a chain of jeq:s to
+    // their leaves (shared by the syscalls with the same rule)
+    struct links {
+        std::size_t ks[linear_max] {};
+        std::size_t leaf[linear_max] {};
+        std::size_t m = 0;
+    };
+
+    constexpr bool chain(std::size_t i, std::size_t j, links& c) const
+    {
+        for(std::size_t k = i; k <= j; k++) {
+            if(!special(k)) continue;
+            if(c.m == linear_max || hi(k) - iv[k].lo != 1) return false;
+
+            c.leaf[c.m] = c.m;
+            for(std::size_t x = 0; x < c.m; x++) {
+                if(same(c.ks[x], k)) {
+                    c.leaf[c.m] = c.leaf[x];
+                    break;
+                }
+            }
+            c.ks[c.m++] = k;
+        }
+        return true;
+    }
+
+    constexpr std::size_t size(std::size_t i, std::size_t j) const
+    {
+        if(i == j) return leaf_size(i);
+
+        links c;
+        if(chain(i, j, c)) {
+            std::size_t s = c.m + 1;
+            for(std::size_t x = 0; x < c.m; x++) {
+                if(c.leaf[x] == x) s += leaf_size(c.ks[x]);
+            }
+            return s;
+        }
+
+        std::size_t mid = (i + j + 1) / 2;
+        std::size_t l = size(i, mid - 1);
+        return 1 + (l > max_jump ? 1 : 0) + l + size(mid, j);
+    }
+
+    constexpr void node(program& p, std::size_t i, std::size_t j) const
+    {
+        if(i == j) {
+            leaf(p, i);
+            return;
+        }
+
+        links c;
+        if(chain(i, j, c)) {
+            std::size_t at[linear_max] {}, o = 0;
+            for(std::size_t x = 0; x < c.m; x++) {
+                if(c.leaf[x] != x) continue;
+                at[x] = o;
+                o += leaf_size(c.ks[x]);
+            }
+
+            for(std::size_t x = 0; x < c.m; x++) {
+                p.push(BPF_JMP|BPF_JEQ|BPF_K, std::uint32_t(iv[c.ks[x]].lo),
+                       c.m - x + at[c.leaf[x]], 0);
+            }
+            p.push(BPF_RET|BPF_K, f.fallthrough.ret);
+            for(std::size_t x = 0; x < c.m; x++) {
+                if(c.leaf[x] == x) leaf(p, c.ks[x]);
+            }
+            return;
+        }
+
+        std::size_t mid = (i + j + 1) / 2;
+        std::uint32_t pivot = std::uint32_t(iv[mid].lo);
+        std::size_t l = size(i, mid - 1);
+        if(l <= max_jump) {
+            p.push(BPF_JMP|BPF_JGE|BPF_K, pivot, l, 0);
+        } else {
+            // too far for a conditional jump: bounce off an unconditional one
+            p.push(BPF_JMP|BPF_JGE|BPF_K, pivot, 0, 1);
+            p.push(BPF_JMP|BPF_JA, std::uint32_t(l));
+        }
+        node(p, i, mid - 1);
+        node(p, mid, j);
+    }
+};
+
+}
+
+constexpr program compile(const filter& f)
+{
+    return detail::compiler(f).compile();
+}
+
+// F: a constexpr function returning the filter
+template<auto F, half h = half::whole>
+constexpr auto assemble()
+{
+    constexpr program p = compile(split(F(), h));
+    std::array<sock_filter, p.len> a {};
+    std::copy_n(p.insns, p.len, a.begin());
+    return a;
+}
+
+}
+
+#endif
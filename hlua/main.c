@@ -76,6 +76,9 @@ struct options {
     const char* tmp;
 
     struct rlimit_spec rlimits[RLIMIT_NLIMITS];
+
+    // the socket to wait for the job on (see warm_wait)
+    int warm;
 };
 
 static void print_usage(int fd, const char* prog)
@@ -86,6 +89,7 @@ static void print_usage(int fd, const char* prog)
     dprintf(fd, "  -l       allow reading /etc/localtime\n");
     dprintf(fd, "  -s       allow reading files beneath the input script's directory\n");
     dprintf(fd, "  -t       allow read+write access to %s\n", DEFAULT_TMP);
+    dprintf(fd, "  -W FD    initialize and then wait for the job on the socket FD (see hsup)\n");
     dprintf(fd, "  -h       print this message\n");
     dprintf(fd, "  -v       print version information\n");
     dprintf(fd, "\n");
@@ -100,11 +104,12 @@ static void parse_options(struct options* o, int argc, char* argv[])
 {
     memset(o, 0, sizeof(*o));
     o->tmp = DEFAULT_TMP;
+    o->warm = -1;
 
     rlimit_default(o->rlimits, LENGTH(o->rlimits));
 
     int res;
-    while((res = getopt(argc, argv, "hlstvr:R")) != -1) {
+    while((res = getopt(argc, argv, "hlstW:vr:R")) != -1) {
         switch(res) {
         case 'l':
             o->allow_localtime = 1;
@@ -115,6 +120,13 @@ static void parse_options(struct options* o, int argc, char* argv[])
         case 't':
             o->allow_tmp = 1;
             break;
+        case 'W':
+            o->warm = warm_parse_fd(optarg);
+            if(o->warm < 0) {
+                dprintf(2, "error: invalid file descriptor: %s\n", optarg);
+                exit(1);
+            }
+            break;
         case 'r': {
             int r = rlimit_parse(o->rlimits, LENGTH(o->rlimits), optarg);
             if(r != 0) {
@@ -136,6 +148,11 @@ static void parse_options(struct options* o, int argc, char* argv[])
         }
     }
 
+    if(o->warm >= 0) {
+        // the input comes with the job
+        return;
+    }
+
     if(optind < argc) {
         o->input = argv[optind];
         debug("input: %s", o->input);
@@ -154,15 +171,52 @@ static void parse_options(struct options* o, int argc, char* argv[])
     }
 }
 
+static lua_State* new_state(void)
+{
+    lua_State* L = luaL_newstate();
+    CHECK_NOT(L, NULL, "unable to create Lua state");
+
+    openlibs(L);
+    remove_stdlib_function(L, "os", "execute");
+    remove_stdlib_function(L, "package", "loadlib");
+
+    return L;
+}
+
 int main(int argc, char* argv[])
 {
+    timing_init("hlua", BUILD_VERSION);
+
     drop_capabilities();
+    timing_phase("drop_capabilities");
     no_new_privs();
+    timing_phase("no_new_privs");
 
     struct options o;
     parse_options(&o, argc, argv);
+    timing_phase("parse_options");
+
+    // a warm process initializes the interpreter before its job's options
+    // (and so its sandbox) are known
+    lua_State* L = NULL;
+    struct warm_job job;
+    if(o.warm >= 0) {
+        L = new_state();
+        timing_phase("init");
+
+        warm_wait(o.warm, &job);
+        timing_phase("warm_wait");
+
+        parse_options(&o, job.argc, job.argv);
+        if(o.warm >= 0) {
+            dprintf(2, "error: a job can't be warm\n");
+            exit(1);
+        }
+        timing_phase("parse_job");
+    }
 
     rlimit_apply(o.rlimits, LENGTH(o.rlimits));
+    timing_phase("rlimit_apply");
 
     int rsfd = landlock_new_ruleset();
 
@@ -192,18 +246,19 @@ int main(int argc, char* argv[])
         debug("allowing read+write access beneath: %s", o.tmp);
         landlock_allow_read_write(rsfd, o.tmp);
     }
+    timing_phase("landlock_rules");
 
     landlock_apply(rsfd);
     int r = close(rsfd); CHECK(r, "close");
+    timing_phase("landlock_apply");
 
     seccomp_apply_filter();
+    timing_phase("seccomp_apply_filter");
 
-    lua_State* L = luaL_newstate();
-    CHECK_NOT(L, NULL, "unable to create Lua state");
-
-    openlibs(L);
-    remove_stdlib_function(L, "os", "execute");
-    remove_stdlib_function(L, "package", "loadlib");
+    if(L == NULL) {
+        L = new_state();
+        timing_phase("init");
+    }
 
     r = luaL_loadfile(L, o.input);
     switch(r) {
@@ -214,6 +269,7 @@ int main(int argc, char* argv[])
     default:
         CHECK_LUA(L, r, "luaL_loadfile(%s)", o.input);
     }
+    timing_phase("load");
 
     r = lua_pcall(L, 0, LUA_MULTRET, 0);
     switch(r) {
@@ -225,8 +281,10 @@ int main(int argc, char* argv[])
     default:
         CHECK_LUA(L, r, "lua_pcall");
     }
+    timing_phase("run");
 
     lua_close(L);
+    timing_phase("teardown");
 
     return 0;
 }
@@ -0,0 +1,2 @@
+// a trivial script: measures the per-script setup and teardown
+console.log("hello");
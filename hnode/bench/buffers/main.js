@@ -0,0 +1,20 @@
+// Buffer churn in node's common sizes with a small live set
+const { performance } = require('perf_hooks');
+
+const sizes = [ 1 << 10, 8 << 10, 16 << 10, 64 << 10 ];
+const live = new Array(64);
+
+const n = 1 << 18;
+const t0 = performance.now();
+for(let i = 0; i < n; i++) {
+    const b = Buffer.alloc(sizes[i & 3]);
+    b[0] = i;
+    live[i & 63] = b;
+}
+const t1 = performance.now();
+
+console.log(JSON.stringify({
+    allocs_per_ms: n / (t1 - t0),
+    rss_mb: process.memoryUsage().rss / (1 << 20),
+    array_buffers_mb: process.memoryUsage().arrayBuffers / (1 << 20),
+}));
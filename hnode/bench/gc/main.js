@@ -0,0 +1,39 @@
+// GC pause times under an allocation heavy workload with a large live set
+const { PerformanceObserver, performance } = require('perf_hooks');
+
+const pauses = [];
+function record(entries) {
+    for(const e of entries) {
+        pauses.push(e.duration);
+    }
+}
+const obs = new PerformanceObserver(function(list) { record(list.getEntries()); });
+obs.observe({ entryTypes: ['gc'] });
+
+const live = new Array(1 << 18);
+let seed = 1;
+function random() {
+    seed = (seed * 1103515245 + 12345) & 0x7fffffff;
+    return seed;
+}
+
+const t0 = performance.now();
+for(let i = 0; i < 1 << 23; i++) {
+    live[random() & (live.length - 1)] = {
+        i, s: "x" + i, a: [i, i + 1, i + 2],
+    };
+}
+const t1 = performance.now();
+
+setTimeout(function() {
+    record(obs.takeRecords());
+    obs.disconnect();
+    pauses.sort((a, b) => a - b);
+    console.log(JSON.stringify({
+        run_ms: t1 - t0,
+        gc_count: pauses.length,
+        gc_pause_total_ms: pauses.reduce((a, b) => a + b, 0),
+        gc_pause_max_ms: pauses.length > 0 ? pauses[pauses.length - 1] : 0,
+        gc_pause_p99_ms: pauses.length > 0 ? pauses[Math.floor(pauses.length * 0.99)] : 0,
+    }));
+}, 10);
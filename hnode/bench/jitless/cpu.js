@@ -0,0 +1,48 @@
+// a CPU heavy workload: an n-body simulation
+const { performance } = require('perf_hooks');
+
+function bodies(n) {
+    const bs = [];
+    let seed = 1;
+    function random() {
+        seed = (seed * 1103515245 + 12345) & 0x7fffffff;
+        return seed / 0x7fffffff;
+    }
+    for(let i = 0; i < n; i++) {
+        bs.push({
+            x: random(), y: random(), z: random(),
+            vx: 0, vy: 0, vz: 0,
+            m: random(),
+        });
+    }
+    return bs;
+}
+
+function advance(bs, dt) {
+    for(let i = 0; i < bs.length; i++) {
+        const a = bs[i];
+        for(let j = i + 1; j < bs.length; j++) {
+            const b = bs[j];
+            const dx = a.x - b.x, dy = a.y - b.y, dz = a.z - b.z;
+            const d2 = dx * dx + dy * dy + dz * dz + 0.01;
+            const mag = dt / (d2 * Math.sqrt(d2));
+            a.vx -= dx * b.m * mag; a.vy -= dy * b.m * mag; a.vz -= dz * b.m * mag;
+            b.vx += dx * a.m * mag; b.vy += dy * a.m * mag; b.vz += dz * a.m * mag;
+        }
+    }
+    for(const b of bs) {
+        b.x += dt * b.vx; b.y += dt * b.vy; b.z += dt * b.vz;
+    }
+}
+
+const bs = bodies(64);
+const t0 = performance.now();
+for(let i = 0; i < 2000; i++) {
+    advance(bs, 0.001);
+}
+const t1 = performance.now();
+
+console.log(JSON.stringify({
+    run_ms: t1 - t0,
+    rss_mb: process.memoryUsage().rss / (1 << 20),
+}));
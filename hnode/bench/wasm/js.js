@@ -0,0 +1,12 @@
+// the kernel of wasm.js in JS
+const { performance } = require('perf_hooks');
+
+function fib(n) {
+    return n < 2 ? n : fib(n - 1) + fib(n - 2);
+}
+
+const t0 = performance.now();
+const r = fib(30);
+const t1 = performance.now();
+
+console.log(JSON.stringify({ compile_ms: 0, run_ms: t1 - t0, result: r }));
@@ -0,0 +1,34 @@
+// a recursive fib kernel compiled to WebAssembly (see js.js)
+const { performance } = require('perf_hooks');
+
+// (module
+//   (func $fib (export "fib") (param i32) (result i32)
+//     (if (result i32) (i32.lt_s (local.get 0) (i32.const 2))
+//       (then (local.get 0))
+//       (else (i32.add
+//         (call $fib (i32.sub (local.get 0) (i32.const 1)))
+//         (call $fib (i32.sub (local.get 0) (i32.const 2))))))))
+const fib_wasm = new Uint8Array([
+    0x00, 0x61, 0x73, 0x6d, 0x01, 0x00, 0x00, 0x00,
+    0x01, 0x06, 0x01, 0x60, 0x01, 0x7f, 0x01, 0x7f,
+    0x03, 0x02, 0x01, 0x00,
+    0x07, 0x07, 0x01, 0x03, 0x66, 0x69, 0x62, 0x00, 0x00,
+    0x0a, 0x1e, 0x01, 0x1c, 0x00,
+    0x20, 0x00, 0x41, 0x02, 0x48, 0x04, 0x7f,
+    0x20, 0x00,
+    0x05,
+    0x20, 0x00, 0x41, 0x01, 0x6b, 0x10, 0x00,
+    0x20, 0x00, 0x41, 0x02, 0x6b, 0x10, 0x00,
+    0x6a,
+    0x0b,
+    0x0b,
+]);
+
+const t0 = performance.now();
+WebAssembly.instantiate(fib_wasm).then(function({ instance }) {
+    const t1 = performance.now();
+    const r = instance.exports.fib(30);
+    const t2 = performance.now();
+
+    console.log(JSON.stringify({ compile_ms: t1 - t0, run_ms: t2 - t1, result: r }));
+});
@@ -1,7 +1,21 @@
 #include <libgen.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cinttypes>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
 
 #include <node.h>
 #include <uv.h>
+#include <v8-profiler.h>
 
 #define RLIMIT_DEFAULT_CPU (1<<2)
 #define RLIMIT_DEFAULT_DATA (1<<30)
@@ -10,156 +24,1957 @@
 #define RLIMIT_DEFAULT_RSS (1<<29)
 #define RLIMIT_DEFAULT_AS ((long unsigned int)1<<31)
 
+#define PLATFORM_THREADS_DEFAULT 1
+#define PLATFORM_THREADS_MAX 64
+
+#define PARALLEL_DEFAULT 1
+#define PARALLEL_MAX 64
+
+// the largest limits accepted by -m, -y and -e (in MB): the ArrayBuffer
+// budget is kept in bytes in a size_t
+#define HEAP_LIMIT_MAX_MB (1L<<20)
+#define SEMI_SPACE_MAX_MB (1L<<10)
+#define ARRAY_BUFFER_BUDGET_MAX_MB ((long)(SIZE_MAX >> 20))
+
+#define EXIT_HEAP_LIMIT 123
+#define EXIT_TIMEOUT 124
+
+// the time given to the exit handlers of a script that exceeded its time
+// budget
+#define WATCHDOG_GRACE 1.0
+
+// the ArrayBuffer allocator's size classes (256B to 64KB, covering node's
+// Buffer pool and stream chunks) and the bytes it keeps pooled per class
+#define POOL_CLASS_MIN_SHIFT 8
+#define POOL_CLASS_MAX_SHIFT 16
+#define POOL_CLASS_CACHE (1<<20)
+
+// the size of the chunks the input script is fed to V8's parser in
+#define INPUT_STREAM_CHUNK (1<<16)
+
+// the heap allowance given to a script terminated for reaching its heap
+// limit to unwind in
+#define HEAP_LIMIT_HEADROOM (16<<20)
+
 #define LIBR_IMPLEMENTATION
 #include "r.h"
 
-#include "capabilities.c"
-#include "seccomp.c"
+#include "capabilities.c"
+#include "seccomp.c"
+#include "seccomp.hpp"
+
+struct options {
+    char** inputs;
+    int n_inputs;
+
+    int allow_script_dir_read;
+    int allow_script_dir_exec;
+
+    int no_snapshot;
+    int jitless;
+    int platform_threads;
+    int parallel;
+    int batch;
+    long max_old_space_mb;
+    long max_semi_space_mb;
+    long array_buffer_budget_mb;
+
+    double wall_budget;
+    double cpu_budget;
+
+    const char* code_cache_dir;
+    int code_cache_write;
+
+    // NB: the profile outputs are opened before the sandbox is applied
+    const char* cpu_profile;
+    const char* heap_profile;
+    const char* heap_snapshot;
+    int cpu_profile_fd;
+    int heap_profile_fd;
+    int heap_snapshot_fd;
+
+    struct rlimit_spec rlimits[RLIMIT_NLIMITS];
+
+    // the socket to wait for the job on (see warm_wait)
+    int warm;
+};
+
+static void print_usage(int fd, const char* prog)
+{
+    dprintf(fd, "usage: %s [OPTION]... INPUT...\n", prog);
+    dprintf(fd, "\n");
+    dprintf(fd, "options:\n");
+    dprintf(fd, "  -s       allow reading files beneath the input scripts' directories\n");
+    dprintf(fd, "  -x       allow executing files beneath the input scripts' directories (implies read access)\n");
+    dprintf(fd, "  -n       bootstrap node instead of using the embedded startup snapshot\n");
+    dprintf(fd, "  -j       run V8 without its JIT compilers and forbid executable mappings\n");
+    dprintf(fd, "  -t N     use N V8 platform worker threads (default %d)\n", PLATFORM_THREADS_DEFAULT);
+    dprintf(fd, "  -p N     run up to N INPUTs concurrently, each on its own thread (default %d)\n", PARALLEL_DEFAULT);
+    dprintf(fd, "  -b       reuse the isolates: run each INPUT in a fresh context and environment\n");
+    dprintf(fd, "  -m MB    limit each isolate's old generation heap to MB megabytes\n");
+    dprintf(fd, "  -y MB    limit each isolate's young generation semi-spaces to MB megabytes\n");
+    dprintf(fd, "  -e MB    limit each isolate's live ArrayBuffer memory to MB megabytes\n");
+    dprintf(fd, "  -w S     limit each script to S seconds of wall-clock time\n");
+    dprintf(fd, "  -u S     limit each script to S seconds of CPU time (of its thread)\n");
+    dprintf(fd, "  -c DIR   use the code cache (of scripts and WebAssembly modules) in DIR (read-only)\n");
+    dprintf(fd, "  -C DIR   use and fill the code cache in DIR\n");
+    dprintf(fd, "  -P FILE  write a CPU profile (.cpuprofile) of the script to FILE\n");
+    dprintf(fd, "  -A FILE  write a sampling heap profile (.heapprofile) of the script to FILE\n");
+    dprintf(fd, "  -H FILE  write a heap snapshot (.heapsnapshot) taken when the script finishes to FILE\n");
+    dprintf(fd, "  -W FD    initialize node and then wait for the job on the socket FD (see hsup)\n");
+    dprintf(fd, "  -h       print this message\n");
+    dprintf(fd, "  -v       print version information\n");
+    dprintf(fd, "\n");
+    dprintf(fd, "rlimit options:\n");
+    dprintf(fd, "  -rRLIMIT=VALUE set RLIMIT to VALUE\n");
+    dprintf(fd, "  -R             use inherited rlimits instead of default\n");
+    dprintf(fd, "\n");
+    dprintf(fd, "exit status:\n");
+    dprintf(fd, "  %d      a script reached its heap limit\n", EXIT_HEAP_LIMIT);
+    dprintf(fd, "  %d      a script exceeded its time budget\n", EXIT_TIMEOUT);
+}
+
+#include "version.c"
+
+static long parse_count(const char* what, const char* str, long max)
+{
+    char* end;
+    long n = strtol(str, &end, 10);
+    if(*str == '\0' || *end != '\0' || n < 1 || n > max) {
+        dprintf(2, "invalid %s: %s\n", what, str);
+        exit(1);
+    }
+    return n;
+}
+
+static double parse_seconds(const char* what, const char* str)
+{
+    char* end;
+    double s = strtod(str, &end);
+    if(*str == '\0' || *end != '\0' || !(s > 0) || !std::isfinite(s)) {
+        dprintf(2, "invalid %s: %s\n", what, str);
+        exit(1);
+    }
+    return s;
+}
+
+static void parse_options(struct options* o, int argc, char* argv[])
+{
+    memset(o, 0, sizeof(*o));
+
+    rlimit_default(o->rlimits, LENGTH(o->rlimits));
+
+    o->platform_threads = PLATFORM_THREADS_DEFAULT;
+    o->parallel = PARALLEL_DEFAULT;
+
+    o->cpu_profile_fd = -1;
+    o->heap_profile_fd = -1;
+    o->heap_snapshot_fd = -1;
+    o->warm = -1;
+
+    int res;
+    while((res = getopt(argc, argv, "hvsxnjt:p:bm:y:e:w:u:c:C:P:A:H:W:r:R")) != -1) {
+        switch(res) {
+        case 's':
+            o->allow_script_dir_read = 1;
+            break;
+        case 'x':
+            o->allow_script_dir_exec = 1;
+            break;
+        case 'n':
+            o->no_snapshot = 1;
+            break;
+        case 'j':
+            o->jitless = 1;
+            break;
+        case 't':
+            o->platform_threads = parse_count("number of platform threads",
+                optarg, PLATFORM_THREADS_MAX);
+            break;
+        case 'p':
+            o->parallel = parse_count("number of concurrent scripts",
+                optarg, PARALLEL_MAX);
+            break;
+        case 'b':
+            o->batch = 1;
+            break;
+        case 'm':
+            o->max_old_space_mb = parse_count("heap limit", optarg,
+                HEAP_LIMIT_MAX_MB);
+            break;
+        case 'y':
+            o->max_semi_space_mb = parse_count("semi-space limit", optarg,
+                SEMI_SPACE_MAX_MB);
+            break;
+        case 'e':
+            o->array_buffer_budget_mb = parse_count("ArrayBuffer budget", optarg,
+                ARRAY_BUFFER_BUDGET_MAX_MB);
+            break;
+        case 'w':
+            o->wall_budget = parse_seconds("wall-clock budget", optarg);
+            break;
+        case 'u':
+            o->cpu_budget = parse_seconds("CPU budget", optarg);
+            break;
+        case 'c':
+            o->code_cache_dir = optarg;
+            o->code_cache_write = 0;
+            break;
+        case 'C':
+            o->code_cache_dir = optarg;
+            o->code_cache_write = 1;
+            break;
+        case 'P':
+            o->cpu_profile = optarg;
+            break;
+        case 'A':
+            o->heap_profile = optarg;
+            break;
+        case 'H':
+            o->heap_snapshot = optarg;
+            break;
+        case 'W':
+            o->warm = warm_parse_fd(optarg);
+            if(o->warm < 0) {
+                dprintf(2, "error: invalid file descriptor: %s\n", optarg);
+                exit(1);
+            }
+            break;
+        case 'r': {
+            int r = rlimit_parse(o->rlimits, LENGTH(o->rlimits), optarg);
+            if(r != 0) {
+                dprintf(1, "unable to parse rlimit: %s\n", optarg);
+                exit(1);
+            }
+            break;
+        }
+        case 'R':
+            rlimit_inherit(o->rlimits, LENGTH(o->rlimits));
+            break;
+        case 'v':
+            print_version(argv[0]);
+            exit(0);
+        case 'h':
+        default:
+            print_usage(res == 'h' ? 1 : 2, argv[0]);
+            exit(res == 'h' ? 0 : 1);
+        }
+    }
+
+    if(o->warm >= 0) {
+        // the inputs come with the job
+        return;
+    }
+
+    if(optind >= argc) {
+        dprintf(2, "error: no input file specified\n");
+        print_usage(2, argv[0]);
+        exit(1);
+    }
+
+    o->inputs = &argv[optind];
+    o->n_inputs = argc - optind;
+
+    if(o->n_inputs > 1 && (o->cpu_profile || o->heap_profile || o->heap_snapshot)) {
+        dprintf(2, "error: profiling requires a single input\n");
+        exit(1);
+    }
+
+#if (NODE_MAJOR_VERSION < 18)
+    if(o->n_inputs > 1 || o->batch) {
+        dprintf(2, "error: multiple inputs and batch mode require node >= 18\n");
+        exit(1);
+    }
+
+    if(o->wall_budget > 0 || o->cpu_budget > 0) {
+        dprintf(2, "error: time budgets require node >= 18\n");
+        exit(1);
+    }
+#endif
+
+    for(int i = 0; i < o->n_inputs; i++) {
+        const char* input = o->inputs[i];
+        debug("input: %s", input);
+
+        struct stat st;
+        int r = stat(input, &st);
+        if(r == -1 && errno == ENOENT) {
+            dprintf(2, "error; unable to access input file: %s\n", input);
+            exit(1);
+        }
+        CHECK(r, "stat(%s)", input);
+    }
+}
+
+#if (NODE_MAJOR_VERSION >= 20)
+static node::EmbedderSnapshotData::Pointer load_snapshot(struct options* o)
+{
+    static const char blob[] = {
+#include "main.snapshotc"
+    };
+
+    if(o->no_snapshot) {
+        debug("not using the embedded snapshot");
+        return {};
+    }
+
+    // NB: the snapshot is built with the JIT's flags, which V8 checks it
+    // against
+    if(o->jitless) {
+        debug("not using the embedded snapshot in jitless mode");
+        return {};
+    }
+
+    if(sizeof(blob) <= 1) {
+        debug("no embedded snapshot");
+        return {};
+    }
+
+    debug("loading embedded snapshot: %zu bytes", sizeof(blob) - 1);
+    auto snapshot = node::EmbedderSnapshotData::FromBlob(
+        std::string_view(blob, sizeof(blob) - 1));
+    if(!snapshot) {
+        warning("unable to load the embedded snapshot");
+    }
+
+    return snapshot;
+}
+#endif
+
+static v8::Local<v8::String> new_string(v8::Isolate* isolate, const char* str)
+{
+#if (NODE_MAJOR_VERSION >= 18)
+    return v8::String::NewFromUtf8(isolate, str).ToLocalChecked();
+#elif (NODE_MAJOR_VERSION >= 12)
+    return v8::String::NewFromUtf8(isolate, str);
+#else
+#error "unsupported node version"
+#endif
+}
+
+struct vm;
+
+// the process-wide state shared by the instances running the inputs
+struct host {
+    node::MultiIsolatePlatform* platform;
+    std::vector<std::string> args;
+    std::vector<std::string> exec_args;
+#if (NODE_MAJOR_VERSION >= 20)
+    const node::EmbedderSnapshotData* snapshot;
+#endif
+    struct options* o;
+
+    // the isolate made before the job (see warm_start) until an input takes it
+    std::atomic<struct vm*> vm{nullptr};
+};
+
+// an environment running one input
+struct instance {
+    struct host* h;
+    const char* input;
+
+    // NB: a tenant shares the process with other instances and so must not
+    // own the process state nor exit the process
+    bool tenant;
+
+    bool exited;
+    int exit_code;
+
+    v8::Isolate* isolate;
+    node::Environment* env;
+    bool heap_limit_reached;
+    size_t initial_heap_limit;
+
+    struct input_script* script;
+};
+
+// an input script compiled by the host: the file is mapped into memory and,
+// when it's ASCII, handed to V8 as an external one-byte string backed by the
+// mapping and streamed to V8's parser on a platform worker thread while the
+// environment bootstraps; other input is decoded into an external two-byte
+// string and compiled when run
+struct input_script {
+    const char* fn;
+    const char* data;
+    size_t len;
+    bool one_byte;
+
+    // NB: ownership of the mapping is passed on to V8 with the one-byte
+    // string
+    bool mapped;
+
+#if (NODE_MAJOR_VERSION >= 18)
+    std::unique_ptr<v8::ScriptCompiler::StreamedSource> source;
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool streaming;
+    bool streamed;
+#endif
+
+    bool consumed;
+};
+
+class mapped_one_byte: public v8::String::ExternalOneByteStringResource {
+public:
+    mapped_one_byte(const char* data, size_t len): data_(data), len_(len) {}
+
+    const char* data() const override { return data_; }
+    size_t length() const override { return len_; }
+
+protected:
+    void Dispose() override {
+        if(len_ > 0) {
+            int r = munmap(const_cast<char*>(data_), len_);
+            CHECK(r, "munmap");
+        }
+        delete this;
+    }
+
+private:
+    const char* data_;
+    size_t len_;
+};
+
+class decoded_two_byte: public v8::String::ExternalStringResource {
+public:
+    decoded_two_byte(const uint8_t* s, size_t n);
+
+    const uint16_t* data() const override { return buf_.data(); }
+    size_t length() const override { return buf_.size(); }
+
+private:
+    std::vector<uint16_t> buf_;
+};
+
+// decode UTF-8 into UTF-16, replacing malformed sequences with U+FFFD
+decoded_two_byte::decoded_two_byte(const uint8_t* s, size_t n)
+{
+    buf_.reserve(n);
+
+    size_t i = 0;
+    while(i < n) {
+        uint32_t c = s[i];
+        size_t l; uint32_t min;
+        if(c < 0x80) {
+            buf_.push_back(c);
+            i += 1;
+            continue;
+        } else if((c & 0xe0) == 0xc0) {
+            l = 2; c &= 0x1f; min = 0x80;
+        } else if((c & 0xf0) == 0xe0) {
+            l = 3; c &= 0x0f; min = 0x800;
+        } else if((c & 0xf8) == 0xf0) {
+            l = 4; c &= 0x07; min = 0x10000;
+        } else {
+            buf_.push_back(0xfffd);
+            i += 1;
+            continue;
+        }
+
+        size_t k = 1;
+        for(; k < l && i + k < n && (s[i+k] & 0xc0) == 0x80; k++) {
+            c = (c << 6) | (s[i+k] & 0x3f);
+        }
+
+        if(k < l || c < min || c > 0x10ffff || (c >= 0xd800 && c <= 0xdfff)) {
+            buf_.push_back(0xfffd);
+            i += k;
+            continue;
+        }
+
+        if(c >= 0x10000) {
+            c -= 0x10000;
+            buf_.push_back(0xd800 + (c >> 10));
+            buf_.push_back(0xdc00 + (c & 0x3ff));
+        } else {
+            buf_.push_back(c);
+        }
+        i += l;
+    }
+}
+
+#if (NODE_MAJOR_VERSION >= 18)
+// feeds the mapped input to V8's parser (which takes ownership of the chunks)
+class input_stream: public v8::ScriptCompiler::ExternalSourceStream {
+public:
+    input_stream(const char* data, size_t len): data_(data), len_(len) {}
+
+    size_t GetMoreData(const uint8_t** src) override {
+        size_t n = std::min(len_ - offset_, (size_t)INPUT_STREAM_CHUNK);
+        if(n == 0) {
+            *src = nullptr;
+            return 0;
+        }
+
+        uint8_t* buf = new uint8_t[n];
+        memcpy(buf, data_ + offset_, n);
+        offset_ += n;
+
+        *src = buf;
+        return n;
+    }
+
+private:
+    const char* data_;
+    size_t len_;
+    size_t offset_ = 0;
+};
+
+class input_streaming_task: public v8::Task {
+public:
+    input_streaming_task(
+        v8::ScriptCompiler::ScriptStreamingTask* task,
+        struct input_script* s): task_(task), s_(s) {}
+
+    void Run() override {
+        task_->Run();
+
+        std::lock_guard<std::mutex> lock(s_->mutex);
+        s_->streamed = true;
+        s_->cv.notify_all();
+    }
+
+private:
+    std::unique_ptr<v8::ScriptCompiler::ScriptStreamingTask> task_;
+    struct input_script* s_;
+};
+#endif
+
+static void input_open(
+        struct input_script* s,
+        struct instance* i,
+        v8::Isolate* isolate)
+{
+    s->fn = i->input;
+    s->consumed = false;
+#if (NODE_MAJOR_VERSION >= 18)
+    s->streaming = false;
+    s->streamed = false;
+#endif
+
+    int fd = open(s->fn, O_RDONLY|O_CLOEXEC);
+    CHECK(fd, "open(%s)", s->fn);
+
+    struct stat st;
+    int r = fstat(fd, &st); CHECK(r, "fstat(%s)", s->fn);
+
+    s->len = st.st_size;
+    if(s->len > 0) {
+        void* p = mmap(NULL, s->len, PROT_READ, MAP_PRIVATE, fd, 0);
+        CHECK_NOT(p, MAP_FAILED, "mmap(%s)", s->fn);
+        s->data = (const char*)p;
+        s->mapped = true;
+    } else {
+        s->data = "";
+        s->mapped = false;
+    }
+
+    r = close(fd); CHECK(r, "close(%s)", s->fn);
+
+    s->one_byte = true;
+    for(size_t j = 0; j < s->len; j++) {
+        if(s->data[j] & 0x80) {
+            s->one_byte = false;
+            break;
+        }
+    }
+    debug("input script %s: %zu bytes (%s)",
+          s->fn, s->len, s->one_byte ? "one-byte" : "UTF-8");
+
+#if (NODE_MAJOR_VERSION >= 18)
+    if(s->one_byte) {
+        debug("streaming: %s", s->fn);
+        s->source = std::make_unique<v8::ScriptCompiler::StreamedSource>(
+            std::make_unique<input_stream>(s->data, s->len),
+            v8::ScriptCompiler::StreamedSource::ONE_BYTE);
+        auto task = v8::ScriptCompiler::StartStreaming(isolate, s->source.get());
+        s->streaming = true;
+        i->h->platform->CallOnWorkerThread(
+            std::make_unique<input_streaming_task>(task, s));
+    }
+#endif
+
+    i->script = s;
+}
+
+static void input_unmap(struct input_script* s)
+{
+    if(s->mapped) {
+        int r = munmap(const_cast<char*>(s->data), s->len);
+        CHECK(r, "munmap(%s)", s->fn);
+        s->mapped = false;
+    }
+}
+
+#if (NODE_MAJOR_VERSION >= 18)
+static void input_wait(struct input_script* s)
+{
+    std::unique_lock<std::mutex> lock(s->mutex);
+    s->cv.wait(lock, [s]{ return s->streamed; });
+}
+#endif
+
+static void input_close(struct input_script* s, struct instance* i)
+{
+#if (NODE_MAJOR_VERSION >= 18)
+    // NB: the streaming task refers to the input and the isolate
+    if(s->streaming) {
+        input_wait(s);
+        s->source.reset();
+    }
+#endif
+    input_unmap(s);
+    i->script = nullptr;
+}
+
+static v8::MaybeLocal<v8::Script> input_compile(
+        struct input_script* s,
+        v8::Isolate* isolate,
+        v8::Local<v8::Context> context)
+{
+    v8::Local<v8::String> source;
+    if(s->one_byte) {
+        auto res = new mapped_one_byte(s->data, s->len);
+        s->mapped = false;
+        if(!v8::String::NewExternalOneByte(isolate, res).ToLocal(&source)) {
+            return {};
+        }
+    } else {
+        auto res = new decoded_two_byte((const uint8_t*)s->data, s->len);
+        input_unmap(s);
+        if(!v8::String::NewExternalTwoByte(isolate, res).ToLocal(&source)) {
+            return {};
+        }
+    }
+
+#if (NODE_MAJOR_VERSION >= 22 || NODE_MAJOR_VERSION < 18)
+    v8::ScriptOrigin origin(new_string(isolate, s->fn));
+#else
+    v8::ScriptOrigin origin(isolate, new_string(isolate, s->fn));
+#endif
+
+#if (NODE_MAJOR_VERSION >= 18)
+    if(s->streaming) {
+        input_wait(s);
+        return v8::ScriptCompiler::Compile(
+            context, s->source.get(), source, origin);
+    }
+#endif
+
+    v8::ScriptCompiler::Source src(source, origin);
+    return v8::ScriptCompiler::Compile(context, &src);
+}
+
+// run_input_script: compile and run the input script (only once)
+static void run_input_script(const v8::FunctionCallbackInfo<v8::Value>& args)
+{
+    v8::Isolate* isolate = args.GetIsolate();
+    v8::Local<v8::Context> context = isolate->GetCurrentContext();
+    auto s = (struct input_script*)args.Data().As<v8::External>()->Value();
+
+    if(s->consumed) {
+        isolate->ThrowException(v8::Exception::Error(
+            new_string(isolate, "input script already run")));
+        return;
+    }
+    s->consumed = true;
+
+    v8::Local<v8::Script> script;
+    if(!input_compile(s, isolate, context).ToLocal(&script)) {
+        return;
+    }
+
+    v8::Local<v8::Value> ret;
+    if(script->Run(context).ToLocal(&ret)) {
+        args.GetReturnValue().Set(ret);
+    }
+}
+
+#if (NODE_MAJOR_VERSION >= 18)
+static bool buffer_source(v8::Local<v8::Value> v, const uint8_t** data, size_t* len)
+{
+    if(v->IsArrayBufferView()) {
+        auto view = v.As<v8::ArrayBufferView>();
+        *data = (const uint8_t*)view->Buffer()->GetBackingStore()->Data()
+            + view->ByteOffset();
+        *len = view->ByteLength();
+        return true;
+    }
+
+    if(v->IsArrayBuffer()) {
+        auto buf = v.As<v8::ArrayBuffer>();
+        *data = (const uint8_t*)buf->GetBackingStore()->Data();
+        *len = buf->ByteLength();
+        return true;
+    }
+
+    return false;
+}
+
+// WebAssembly.compileStreaming as used by main.js' cache_wasm: the source is
+// an object holding the module's bytes and, when there is any, its cached
+// native code
+static void wasm_streaming(const v8::FunctionCallbackInfo<v8::Value>& args)
+{
+    v8::Isolate* isolate = args.GetIsolate();
+    v8::Local<v8::Context> context = isolate->GetCurrentContext();
+    auto streaming = v8::WasmStreaming::Unpack(isolate, args.Data());
+
+    const uint8_t* bytes; size_t len;
+    v8::Local<v8::Value> b;
+    if(!args[0]->IsObject()
+       || !args[0].As<v8::Object>()->Get(context, new_string(isolate, "bytes")).ToLocal(&b)
+       || !buffer_source(b, &bytes, &len)) {
+        streaming->Abort(v8::Exception::TypeError(
+            new_string(isolate, "expected the bytes of a WebAssembly module")));
+        return;
+    }
+
+    v8::Local<v8::Value> c;
+    const uint8_t* cached; size_t cached_len;
+    if(args[0].As<v8::Object>()->Get(context, new_string(isolate, "cached")).ToLocal(&c)
+       && buffer_source(c, &cached, &cached_len)) {
+        debug("using cached WebAssembly module: %zu bytes", cached_len);
+        streaming->SetCompiledModuleBytes(cached, cached_len);
+    }
+
+    streaming->OnBytesReceived(bytes, len);
+    streaming->Finish();
+}
+
+// NB: node installs its own streaming callback (for fetch's Response) while
+// bootstrapping, so the cache's is installed by main.js
+static void wasm_streaming_install(const v8::FunctionCallbackInfo<v8::Value>& args)
+{
+    args.GetIsolate()->SetWasmStreamingCallback(wasm_streaming);
+}
+
+// wasm_module_serialize: the native code compiled so far for a module
+static void wasm_module_serialize(const v8::FunctionCallbackInfo<v8::Value>& args)
+{
+    v8::Isolate* isolate = args.GetIsolate();
+
+    if(!args[0]->IsWasmModuleObject()) {
+        isolate->ThrowException(v8::Exception::TypeError(
+            new_string(isolate, "expected a WebAssembly.Module")));
+        return;
+    }
+
+    v8::CompiledWasmModule compiled =
+        args[0].As<v8::WasmModuleObject>()->GetCompiledModule();
+    v8::OwnedBuffer buf = compiled.Serialize();
+
+    auto ab = v8::ArrayBuffer::New(isolate, buf.size);
+    if(buf.size > 0) {
+        memcpy(ab->GetBackingStore()->Data(), buf.buffer.get(), buf.size);
+    }
+    args.GetReturnValue().Set(ab);
+}
+#endif
+
+// globals read by main.js
+static void set_globals(
+        v8::Isolate* isolate,
+        v8::Local<v8::Context> context,
+        struct instance* i)
+{
+    struct options* o = i->h->o;
+    auto global = context->Global();
+
+    global->Set(context,
+        new_string(isolate, "input_script_filename"),
+        new_string(isolate, i->input)
+    ).Check();
+
+    if(o->code_cache_dir) {
+        global->Set(context,
+            new_string(isolate, "code_cache_dir"),
+            new_string(isolate, o->code_cache_dir)
+        ).Check();
+
+        global->Set(context,
+            new_string(isolate, "code_cache_write"),
+            v8::Boolean::New(isolate, o->code_cache_write)
+        ).Check();
+
+#if (NODE_MAJOR_VERSION >= 18)
+        global->Set(context,
+            new_string(isolate, "wasm_streaming_install"),
+            v8::Function::New(context, wasm_streaming_install).ToLocalChecked()
+        ).Check();
+
+        global->Set(context,
+            new_string(isolate, "wasm_module_serialize"),
+            v8::Function::New(context, wasm_module_serialize).ToLocalChecked()
+        ).Check();
+#endif
+    }
+
+    if(i->script) {
+        global->Set(context,
+            new_string(isolate, "run_input_script"),
+            v8::Function::New(context, run_input_script,
+                v8::External::New(isolate, i->script)).ToLocalChecked()
+        ).Check();
+    }
+}
+
+#if (NODE_MAJOR_VERSION >= 18)
+static node::EnvironmentFlags::Flags environment_flags(struct instance* i)
+{
+    return i->tenant
+        ? node::EnvironmentFlags::kNoFlags
+        : node::EnvironmentFlags::kDefaultFlags;
+}
+
+// process.exit() and uncaught exceptions in a tenant stop its environment
+// instead of exiting the process
+static void set_exit_handler(node::Environment* env, struct instance* i)
+{
+    if(!i->tenant) {
+        return;
+    }
+
+    node::SetProcessExitHandler(env, [i](node::Environment* env, int exit_code) {
+        debug("%s: exit: %d", i->input, exit_code);
+        if(!i->exited) {
+            i->exited = true;
+            i->exit_code = exit_code;
+        }
+        node::Stop(env);
+    });
+}
+#endif
+
+// stop an instance that's about to run out of heap, instead of letting V8
+// fail with a fatal out of memory error, and give it room to unwind
+static size_t near_heap_limit(void* data, size_t current_heap_limit,
+                              size_t initial_heap_limit)
+{
+    struct instance* i = static_cast<struct instance*>(data);
+
+    if(!i->heap_limit_reached) {
+        i->heap_limit_reached = true;
+        i->initial_heap_limit = initial_heap_limit;
+
+        v8::HeapStatistics hs;
+        i->isolate->GetHeapStatistics(&hs);
+        dprintf(2, "%s: heap limit reached: used=%zu total=%zu limit=%zu external=%zu\n",
+                i->input, hs.used_heap_size(), hs.total_heap_size(),
+                hs.heap_size_limit(), hs.external_memory());
+
+        i->exited = true;
+        i->exit_code = EXIT_HEAP_LIMIT;
+        node::Stop(i->env);
+    }
+
+    return current_heap_limit + HEAP_LIMIT_HEADROOM;
+}
+
+static void watch_heap(v8::Isolate* isolate, node::Environment* env,
+                       struct instance* i)
+{
+    i->isolate = isolate;
+    i->env = env;
+    isolate->AddNearHeapLimitCallback(near_heap_limit, i);
+}
+
+static void unwatch_heap(struct instance* i)
+{
+    // NB: restores the limit raised by near_heap_limit (when non-zero) so
+    // that a reused isolate doesn't accumulate headroom
+    i->isolate->RemoveNearHeapLimitCallback(near_heap_limit,
+                                            i->initial_heap_limit);
+}
+
+static double clock_seconds(clockid_t clock)
+{
+    struct timespec ts;
+    int r = clock_gettime(clock, &ts);
+    CHECK(r, "clock_gettime(%d)", clock);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// enforces an instance's wall-clock and CPU time budgets: on expiry the
+// script's execution is terminated and its event loop stopped, leaving its
+// exit handlers a grace period before they are terminated as well
+struct watchdog {
+    struct instance* i;
+    uv_loop_t* loop;
+
+    // NB: the CPU time of the script's thread
+    clockid_t cpu_clock;
+    double wall_start;
+    double cpu_start;
+
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool disarmed;
+    bool grace_expired;
+    std::atomic<bool> fired;
+};
+
+static double watchdog_wall(struct watchdog* w)
+{
+    return clock_seconds(CLOCK_MONOTONIC) - w->wall_start;
+}
+
+static double watchdog_cpu(struct watchdog* w)
+{
+    return clock_seconds(w->cpu_clock) - w->cpu_start;
+}
+
+static void watchdog_interrupt(void* data)
+{
+    uv_stop(static_cast<uv_loop_t*>(data));
+}
+
+static void watchdog_run(struct watchdog* w)
+{
+    struct options* o = w->i->h->o;
+    std::unique_lock<std::mutex> lock(w->mutex);
+
+    while(!w->disarmed) {
+        double wall = o->wall_budget > 0 ? o->wall_budget - watchdog_wall(w) : INFINITY;
+        double cpu = o->cpu_budget > 0 ? o->cpu_budget - watchdog_cpu(w) : INFINITY;
+        if(wall <= 0 || cpu <= 0) {
+            break;
+        }
+
+        // NB: CPU time doesn't accumulate faster than wall-clock time
+        w->cv.wait_for(lock, std::chrono::duration<double>(std::min(wall, cpu)));
+    }
+
+    if(w->disarmed) {
+        return;
+    }
+
+    debug("%s: watchdog fired", w->i->input);
+    w->fired = true;
+    w->i->isolate->TerminateExecution();
+#if (NODE_MAJOR_VERSION >= 18)
+    node::RequestInterrupt(w->i->env, watchdog_interrupt, w->loop);
+#endif
+
+    if(!w->cv.wait_for(lock, std::chrono::duration<double>(WATCHDOG_GRACE),
+                       [w] { return w->disarmed; })) {
+        debug("%s: watchdog grace period expired", w->i->input);
+        w->grace_expired = true;
+        w->i->isolate->TerminateExecution();
+    }
+}
+
+// NB: called on the script's thread
+static void watchdog_start(struct watchdog* w, struct instance* i, uv_loop_t* loop)
+{
+    struct options* o = i->h->o;
+
+    w->i = i;
+    w->loop = loop;
+    w->disarmed = false;
+    w->grace_expired = false;
+    w->fired = false;
+
+    if(o->wall_budget <= 0 && o->cpu_budget <= 0) {
+        return;
+    }
+
+    int r = pthread_getcpuclockid(pthread_self(), &w->cpu_clock);
+    if(r != 0) {
+        errno = r;
+        failwith("pthread_getcpuclockid");
+    }
+
+    w->wall_start = clock_seconds(CLOCK_MONOTONIC);
+    w->cpu_start = clock_seconds(w->cpu_clock);
+
+    w->thread = std::thread(watchdog_run, w);
+}
+
+static void watchdog_stop(struct watchdog* w)
+{
+    {
+        std::lock_guard<std::mutex> lock(w->mutex);
+        w->disarmed = true;
+    }
+    w->cv.notify_one();
+
+    if(w->thread.joinable()) {
+        w->thread.join();
+    }
+}
+
+// spin the environment's event loop until it's done, the script exits or
+// its watchdog fires, then emit the process' exit event
+static int spin_event_loop(uv_loop_t* loop, v8::Isolate* isolate,
+                           node::Environment* env, struct instance* i,
+                           struct watchdog* w)
+{
+    struct host* h = i->h;
+    int exit_code = 0;
+
+    {
+        v8::SealHandleScope seal(isolate);
+        bool more;
+        do {
+            debug("running loop");
+            int r = uv_run(loop, UV_RUN_DEFAULT);
+            CHECK_UV(r, "uv_run");
+            if(i->exited || w->fired) break;
+
+            debug("draining tasks");
+            h->platform->DrainTasks(isolate);
+
+            more = uv_loop_alive(loop);
+            if(more) continue;
+
+            debug("emit before exit");
+#if (NODE_MAJOR_VERSION >= 18)
+            node::EmitProcessBeforeExit(env);
+#elif (NODE_MAJOR_VERSION == 12)
+            node::EmitBeforeExit(env);
+#else
+#error "unsupported node version"
+#endif
+
+            more = uv_loop_alive(loop);
+        } while(more && !i->exited && !w->fired);
+    }
+
+    if(w->fired) {
+        dprintf(2, "%s: time budget exceeded: wall=%.3fs cpu=%.3fs\n",
+                i->input, watchdog_wall(w), watchdog_cpu(w));
+
+        // let the exit handlers run (within the grace period)
+        std::lock_guard<std::mutex> lock(w->mutex);
+        if(!w->grace_expired) {
+            isolate->CancelTerminateExecution();
+        }
+    }
+
+    if(!i->exited) {
+        debug("emit exit");
+#if (NODE_MAJOR_VERSION >= 18)
+        exit_code = node::EmitProcessExit(env).FromMaybe(1);
+#elif (NODE_MAJOR_VERSION == 12)
+        exit_code = node::EmitExit(env);
+#else
+#error "unsupported node version"
+#endif
+    }
+
+    watchdog_stop(w);
+
+    if(w->fired) {
+        return EXIT_TIMEOUT;
+    }
+
+    return i->exited ? i->exit_code : exit_code;
+}
+
+// the profilers requested by the options, started before the environment
+// is loaded and written out when the script's event loop is done
+struct profile {
+    v8::CpuProfiler* cpu;
+    v8::Local<v8::String> title;
+    bool sampling_heap;
+};
+
+static void profile_start(struct profile* p, v8::Isolate* isolate, struct instance* i)
+{
+    struct options* o = i->h->o;
+
+    p->cpu = nullptr;
+    p->sampling_heap = false;
+
+    if(o->heap_profile_fd >= 0) {
+        debug("starting the sampling heap profiler");
+        isolate->GetHeapProfiler()->StartSamplingHeapProfiler();
+        p->sampling_heap = true;
+    }
+
+    if(o->cpu_profile_fd >= 0) {
+        debug("starting the CPU profiler");
+        p->cpu = v8::CpuProfiler::New(isolate);
+        p->title = new_string(isolate, i->input);
+        p->cpu->StartProfiling(p->title, true);
+    }
+}
+
+static FILE* profile_output(int fd)
+{
+    FILE* f = fdopen(fd, "w");
+    CHECK_NOT(f, NULL, "fdopen");
+    return f;
+}
+
+static void profile_close(FILE* f, const char* fn)
+{
+    if(ferror(f)) {
+        failwith("unable to write: %s", fn);
+    }
+    int r = fclose(f); CHECK(r, "fclose(%s)", fn);
+}
+
+static void json_string(FILE* f, const char* s)
+{
+    fputc('"', f);
+    for(; *s; s++) {
+        unsigned char c = *s;
+        if(c == '"' || c == '\\') {
+            fprintf(f, "\\%c", c);
+        } else if(c < 0x20) {
+            fprintf(f, "\\u%04x", c);
+        } else {
+            fputc(c, f);
+        }
+    }
+    fputc('"', f);
+}
+
+// a call frame in the format of the DevTools protocol (with zero-based line
+// and column numbers)
+static void json_call_frame(
+        FILE* f, v8::Isolate* isolate,
+        v8::Local<v8::String> name, v8::Local<v8::String> url,
+        int script_id, int line, int column)
+{
+    v8::String::Utf8Value n(isolate, name), u(isolate, url);
+    fputs("{\"functionName\":", f);
+    json_string(f, *n ? *n : "");
+    fprintf(f, ",\"scriptId\":\"%d\",\"url\":", script_id);
+    json_string(f, *u ? *u : "");
+    fprintf(f, ",\"lineNumber\":%d,\"columnNumber\":%d}", line - 1, column - 1);
+}
+
+static void json_cpu_node(FILE* f, v8::Isolate* isolate, const v8::CpuProfileNode* n)
+{
+    fprintf(f, "{\"id\":%u,\"callFrame\":", n->GetNodeId());
+    json_call_frame(f, isolate,
+        n->GetFunctionName(), n->GetScriptResourceName(),
+        n->GetScriptId(), n->GetLineNumber(), n->GetColumnNumber());
+    fprintf(f, ",\"hitCount\":%u,\"children\":[", n->GetHitCount());
+    for(int j = 0; j < n->GetChildrenCount(); j++) {
+        fprintf(f, "%s%u", j > 0 ? "," : "", n->GetChild(j)->GetNodeId());
+    }
+    fputs("]}", f);
+
+    for(int j = 0; j < n->GetChildrenCount(); j++) {
+        fputc(',', f);
+        json_cpu_node(f, isolate, n->GetChild(j));
+    }
+}
+
+// .cpuprofile: the DevTools protocol's Profiler.Profile
+static void write_cpu_profile(FILE* f, v8::Isolate* isolate, const v8::CpuProfile* p)
+{
+    fputs("{\"nodes\":[", f);
+    json_cpu_node(f, isolate, p->GetTopDownRoot());
+
+    fprintf(f, "],\"startTime\":%" PRId64 ",\"endTime\":%" PRId64,
+            p->GetStartTime(), p->GetEndTime());
+
+    fputs(",\"samples\":[", f);
+    for(int j = 0; j < p->GetSamplesCount(); j++) {
+        fprintf(f, "%s%u", j > 0 ? "," : "", p->GetSample(j)->GetNodeId());
+    }
+
+    fputs("],\"timeDeltas\":[", f);
+    int64_t t = p->GetStartTime();
+    for(int j = 0; j < p->GetSamplesCount(); j++) {
+        int64_t ts = p->GetSampleTimestamp(j);
+        fprintf(f, "%s%" PRId64, j > 0 ? "," : "", ts - t);
+        t = ts;
+    }
+    fputs("]}\n", f);
+}
+
+static void json_heap_node(FILE* f, v8::Isolate* isolate, const v8::AllocationProfile::Node* n)
+{
+    size_t self_size = 0;
+    for(const auto& a: n->allocations) {
+        self_size += a.size * a.count;
+    }
+
+    fputs("{\"callFrame\":", f);
+    json_call_frame(f, isolate,
+        n->name, n->script_name,
+        n->script_id, n->line_number, n->column_number);
+    fprintf(f, ",\"selfSize\":%zu,\"id\":%u,\"children\":[", self_size, n->node_id);
+    for(size_t j = 0; j < n->children.size(); j++) {
+        if(j > 0) fputc(',', f);
+        json_heap_node(f, isolate, n->children[j]);
+    }
+    fputs("]}", f);
+}
+
+// .heapprofile: the DevTools protocol's HeapProfiler.SamplingHeapProfile
+static void write_heap_profile(FILE* f, v8::Isolate* isolate, v8::AllocationProfile* p)
+{
+    fputs("{\"head\":", f);
+    json_heap_node(f, isolate, p->GetRootNode());
+
+    fputs(",\"samples\":[", f);
+#if (NODE_MAJOR_VERSION >= 14)
+    bool first = true;
+    for(const auto& s: p->GetSamples()) {
+        fprintf(f, "%s{\"size\":%zu,\"nodeId\":%u,\"ordinal\":%" PRIu64 "}",
+                first ? "" : ",", s.size * s.count, s.node_id, s.sample_id);
+        first = false;
+    }
+#endif
+    fputs("]}\n", f);
+}
+
+class file_output_stream: public v8::OutputStream {
+public:
+    file_output_stream(FILE* f): f_(f) {}
+
+    int GetChunkSize() override { return 1<<16; }
+    void EndOfStream() override {}
+
+    WriteResult WriteAsciiChunk(char* data, int size) override {
+        return fwrite(data, 1, size, f_) == (size_t)size ? kContinue : kAbort;
+    }
+
+private:
+    FILE* f_;
+};
+
+static void profile_stop(struct profile* p, v8::Isolate* isolate, struct instance* i)
+{
+    struct options* o = i->h->o;
+    v8::HandleScope handle_scope(isolate);
+
+    if(p->cpu) {
+        v8::CpuProfile* cp = p->cpu->StopProfiling(p->title);
+        if(cp) {
+            info("writing CPU profile: %s", o->cpu_profile);
+            FILE* f = profile_output(o->cpu_profile_fd);
+            write_cpu_profile(f, isolate, cp);
+            profile_close(f, o->cpu_profile);
+            cp->Delete();
+        } else {
+            warning("no CPU profile recorded");
+        }
+        p->cpu->Dispose();
+        p->cpu = nullptr;
+    }
+
+    v8::HeapProfiler* hp = isolate->GetHeapProfiler();
+    if(p->sampling_heap) {
+        std::unique_ptr<v8::AllocationProfile> ap(hp->GetAllocationProfile());
+        hp->StopSamplingHeapProfiler();
+        if(ap) {
+            info("writing sampling heap profile: %s", o->heap_profile);
+            FILE* f = profile_output(o->heap_profile_fd);
+            write_heap_profile(f, isolate, ap.get());
+            profile_close(f, o->heap_profile);
+        } else {
+            warning("no heap profile recorded");
+        }
+        p->sampling_heap = false;
+    }
+
+    if(o->heap_snapshot_fd >= 0) {
+        info("writing heap snapshot: %s", o->heap_snapshot);
+        const v8::HeapSnapshot* hs = hp->TakeHeapSnapshot();
+        FILE* f = profile_output(o->heap_snapshot_fd);
+        file_output_stream stream(f);
+        hs->Serialize(&stream, v8::HeapSnapshot::kJSON);
+        profile_close(f, o->heap_snapshot);
+        const_cast<v8::HeapSnapshot*>(hs)->Delete();
+    }
+}
+
+// the allocator of an isolate's ArrayBuffer backing stores: the common
+// sizes are served from pooled size classes (up to POOL_CLASS_CACHE bytes
+// are kept per class, beyond that blocks are returned to malloc) and the
+// bytes live at any time are limited to a budget
+// NB: node's own allocator isn't extensible, so node bootstraps without it
+// (see node::CreateIsolateData) and Buffer.allocUnsafe gets zeroed memory
+class pool_allocator: public node::ArrayBufferAllocator {
+public:
+    pool_allocator(size_t budget): budget_(budget) {}
+    ~pool_allocator() override;
+
+    void* Allocate(size_t len) override { return allocate(len, true); }
+    void* AllocateUninitialized(size_t len) override { return allocate(len, false); }
+    void Free(void* data, size_t len) override;
+
+    void log_stats(const char* what);
+
+    void set_budget(size_t budget);
+
+private:
+    node::NodeArrayBufferAllocator* GetImpl() override { return nullptr; }
+
+    void* allocate(size_t len, bool zero);
+
+    static int size_class(size_t len);
+
+    struct block {
+        struct block* next;
+    };
+
+    std::mutex mutex_;
+    struct block* pools_[POOL_CLASS_MAX_SHIFT - POOL_CLASS_MIN_SHIFT + 1] = {};
+    size_t pooled_[POOL_CLASS_MAX_SHIFT - POOL_CLASS_MIN_SHIFT + 1] = {};
+
+    size_t budget_;
+    bool over_budget_ = false;
+
+    size_t live_ = 0;
+    size_t peak_ = 0;
+    size_t allocations_ = 0;
+    size_t pool_hits_ = 0;
+};
+
+// the index of the size class serving len bytes, or -1 when it's too large
+int pool_allocator::size_class(size_t len)
+{
+    int shift = len <= 1 ? 0 : 64 - __builtin_clzl(len - 1);
+    if(shift > POOL_CLASS_MAX_SHIFT) {
+        return -1;
+    }
+    return std::max(shift, POOL_CLASS_MIN_SHIFT) - POOL_CLASS_MIN_SHIFT;
+}
+
+void* pool_allocator::allocate(size_t len, bool zero)
+{
+    int c = size_class(len);
+    void* p = nullptr;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        if(budget_ > 0 && live_ + len > budget_) {
+            if(!over_budget_) {
+                warning("ArrayBuffer budget exceeded: live=%zu requested=%zu budget=%zu",
+                        live_, len, budget_);
+                over_budget_ = true;
+            }
+            return nullptr;
+        }
+
+        if(c >= 0 && pools_[c]) {
+            p = pools_[c];
+            pools_[c] = pools_[c]->next;
+            pooled_[c] -= (size_t)1 << (c + POOL_CLASS_MIN_SHIFT);
+            pool_hits_ += 1;
+        }
+
+        live_ += len;
+        peak_ = std::max(peak_, live_);
+        allocations_ += 1;
+    }
+
+    if(p) {
+        if(zero) {
+            memset(p, 0, len);
+        }
+        return p;
+    }
+
+    size_t size = c >= 0 ? (size_t)1 << (c + POOL_CLASS_MIN_SHIFT) : len;
+    p = zero ? calloc(1, size) : malloc(size);
+    if(p == nullptr) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        live_ -= len;
+    }
+    return p;
+}
+
+// NB: V8 may free backing stores on its background threads
+void pool_allocator::Free(void* data, size_t len)
+{
+    if(data == nullptr) {
+        return;
+    }
+
+    int c = size_class(len);
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        live_ -= len;
+        if(live_ < budget_) {
+            over_budget_ = false;
+        }
+
+        size_t size = (size_t)1 << (c + POOL_CLASS_MIN_SHIFT);
+        if(c >= 0 && pooled_[c] + size <= POOL_CLASS_CACHE) {
+            struct block* b = static_cast<struct block*>(data);
+            b->next = pools_[c];
+            pools_[c] = b;
+            pooled_[c] += size;
+            return;
+        }
+    }
+
+    free(data);
+}
+
+pool_allocator::~pool_allocator()
+{
+    for(size_t c = 0; c < LENGTH(pools_); c++) {
+        while(pools_[c]) {
+            struct block* b = pools_[c];
+            pools_[c] = b->next;
+            free(b);
+        }
+    }
+}
+
+// change the budget (e.g. to a warm process's job's -e): the bytes already
+// live count against it
+void pool_allocator::set_budget(size_t budget)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    budget_ = budget;
+}
+
+// log and reset the peak to the current live bytes
+void pool_allocator::log_stats(const char* what)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    size_t pooled = 0;
+    for(size_t c = 0; c < LENGTH(pooled_); c++) {
+        pooled += pooled_[c];
+    }
+
+    info("%s: ArrayBuffers: live=%zu peak=%zu pooled=%zu allocations=%zu pool hits=%zu",
+         what, live_, peak_, pooled, allocations_, pool_hits_);
+
+    peak_ = live_;
+    allocations_ = 0;
+    pool_hits_ = 0;
+}
+
+// an isolate, and the event loop it runs on, hosting the environments
+// running the inputs
+struct vm {
+    uv_loop_t loop;
+    std::unique_ptr<pool_allocator> allocator;
+    v8::Isolate* isolate;
+    node::IsolateData* isolate_data;
+};
+
+static void vm_init(struct vm* vm, struct host* h)
+{
+    debug("initializing uv loop");
+    int r = uv_loop_init(&vm->loop);
+    CHECK_UV(r, "uv_loop_init");
+
+    debug("creating allocator");
+    vm->allocator = std::make_unique<pool_allocator>(
+        (size_t)h->o->array_buffer_budget_mb << 20);
+
+    debug("creating v8::Isolate");
+#if (NODE_MAJOR_VERSION >= 20)
+    vm->isolate = node::NewIsolate(vm->allocator.get(), &vm->loop,
+                                   h->platform, h->snapshot);
+#else
+    vm->isolate = node::NewIsolate(vm->allocator.get(), &vm->loop,
+                                   h->platform);
+#endif
+    if(vm->isolate == nullptr) {
+        failwith("unable to create v8::Isolate");
+    }
+
+    v8::Locker locker(vm->isolate);
+    v8::Isolate::Scope isolate_scope(vm->isolate);
+
+    debug("creating node::IsolateData");
+#if (NODE_MAJOR_VERSION >= 20)
+    vm->isolate_data = node::CreateIsolateData(vm->isolate, &vm->loop,
+        h->platform, vm->allocator.get(), h->snapshot);
+#else
+    vm->isolate_data = node::CreateIsolateData(vm->isolate, &vm->loop,
+        h->platform);
+#endif
+}
+
+static void vm_free(struct vm* vm, struct host* h)
+{
+    {
+        v8::Locker locker(vm->isolate);
+        v8::Isolate::Scope isolate_scope(vm->isolate);
+        node::FreeIsolateData(vm->isolate_data);
+    }
+
+    debug("disposing isolate");
+    bool platform_finished = false;
+    h->platform->AddIsolateFinishedCallback(vm->isolate, [](void* data) {
+        debug("callbacking");
+        *static_cast<bool*>(data) = true;
+    }, &platform_finished);
+    h->platform->UnregisterIsolate(vm->isolate);
+    vm->isolate->Dispose();
+
+    while(!platform_finished) {
+        debug("waiting for platform to finish");
+        int r = uv_run(&vm->loop, UV_RUN_ONCE);
+        CHECK_UV(r, "uv_run");
+    }
+
+    debug("closing loop");
+    int r = uv_loop_close(&vm->loop);
+    CHECK_UV(r, "uv_loop_close");
+}
+
+// the host's isolate if it's not been taken yet, or else a new one
+static struct vm* vm_get(struct host* h, struct vm* own)
+{
+    struct vm* vm = h->vm.exchange(nullptr);
+    if(vm == nullptr) {
+        vm_init(own, h);
+        vm = own;
+    }
+    return vm;
+}
+
+// run an input in a fresh context and environment of the vm's isolate
+static int run_environment(struct vm* vm, struct instance* i)
+{
+    struct host* h = i->h;
+    v8::Isolate* isolate = vm->isolate;
+    int exit_code = 0;
+
+    v8::Locker locker(isolate);
+    v8::Isolate::Scope isolate_scope(isolate);
+
+    {
+        v8::HandleScope handle_scope(isolate);
+
+        // NB: an environment deserialized from a snapshot brings its own
+        // context (see node::GetMainContext)
+        v8::Local<v8::Context> context;
+#if (NODE_MAJOR_VERSION >= 20)
+        if(!h->snapshot)
+#endif
+        {
+            context = node::NewContext(isolate);
+            if(context.IsEmpty()) {
+                failwith("unable to initialize v8::Context");
+            }
+        }
+
+        debug("creating node::Environment");
+        std::unique_ptr<node::Environment, decltype(&node::FreeEnvironment)>
+            env(
+                node::CreateEnvironment(
+                    vm->isolate_data, context,
+#if (NODE_MAJOR_VERSION >= 18)
+                    h->args, h->exec_args, environment_flags(i)
+#elif (NODE_MAJOR_VERSION >= 12)
+                    h->args, h->exec_args
+#else
+#error "unsupported node version"
+#endif
+                ),
+                node::FreeEnvironment);
+        if(!env) {
+            failwith("unable to create environment");
+        }
+
+#if (NODE_MAJOR_VERSION >= 18)
+        set_exit_handler(env.get(), i);
+#endif
+        watch_heap(isolate, env.get(), i);
+
+        struct watchdog w;
+        watchdog_start(&w, i, &vm->loop);
+
+        // NB: the code cache is handled by main.js
+        struct input_script script;
+        if(!h->o->code_cache_dir) {
+            input_open(&script, i, isolate);
+        }
+
+#if (NODE_MAJOR_VERSION >= 20)
+        if(h->snapshot) {
+            context = node::GetMainContext(env.get());
+        }
+#endif
+
+        set_globals(isolate, context, i);
+
+        v8::Context::Scope context_scope(context);
+
+        const char main_script_source_utf8[] = {
+#include "main.jsc"
+        };
+
+        struct profile p;
+        profile_start(&p, isolate, i);
+
+        debug("loading environment");
+#if (NODE_MAJOR_VERSION >= 20)
+        auto loadenv_ret = h->snapshot
+            ? node::LoadEnvironment(env.get(), node::StartExecutionCallback{})
+            : node::LoadEnvironment(env.get(), main_script_source_utf8);
+#else
+        auto loadenv_ret = node::LoadEnvironment(
+            env.get(), main_script_source_utf8);
+#endif
+        if (loadenv_ret.IsEmpty() && !i->exited && !w.fired) {
+            failwith("unable to load envionment");
+        }
+
+        exit_code = spin_event_loop(&vm->loop, isolate, env.get(), i, &w);
+
+        profile_stop(&p, isolate, i);
+
+        if(i->script) {
+            input_close(&script, i);
+        }
+
+        unwatch_heap(i);
+
+        debug("stopping env");
+        node::Stop(env.get());
+    }
+
+    vm->allocator->log_stats(i->input);
+
+    // NB: stopping the environment terminated the isolate's execution, lift
+    // it so that the isolate can host the next environment
+    isolate->CancelTerminateExecution();
+    isolate->ContextDisposedNotification();
+
+    return exit_code;
+}
+
+// NB: the isolate is created by the host (and not by
+// node::CommonEnvironmentSetup) so that it uses the host's allocator
+static int run_instance(struct instance* i)
+{
+    struct vm own;
+    struct vm* vm = vm_get(i->h, &own);
+    int exit_code = run_environment(vm, i);
+    vm_free(vm, i->h);
+    return exit_code;
+}
+
+// run the inputs, up to o->parallel at a time each on its own thread, and
+// return the first non-zero exit code
+static int run_inputs(struct host* h)
+{
+    struct options* o = h->o;
+
+    std::vector<struct instance> is(o->n_inputs);
+    for(int k = 0; k < o->n_inputs; k++) {
+        is[k].h = h;
+        is[k].input = o->inputs[k];
+        is[k].tenant = o->n_inputs > 1 || o->batch;
+    }
+
+    // NB: in batch mode each thread creates one isolate and runs its share
+    // of the inputs in it
+    std::atomic<int> next(0);
+    auto worker = [&]() {
+        struct vm own;
+        struct vm* vm = nullptr;
+
+        int k;
+        while((k = next++) < o->n_inputs) {
+            debug("running: %s", is[k].input);
+            if(o->batch) {
+                if(vm == nullptr) {
+                    vm = vm_get(h, &own);
+                }
+                is[k].exit_code = run_environment(vm, &is[k]);
+            } else {
+                is[k].exit_code = run_instance(&is[k]);
+            }
+        }
+
+        if(vm != nullptr) {
+            vm_free(vm, h);
+        }
+    };
+
+    int n = std::min(o->parallel, o->n_inputs);
+    if(n <= 1) {
+        worker();
+    } else {
+        debug("running %d inputs on %d threads", o->n_inputs, n);
+        std::vector<std::thread> ts;
+        for(int k = 0; k < n; k++) {
+            ts.emplace_back(worker);
+        }
+        for(std::thread& t: ts) {
+            t.join();
+        }
+    }
+
+    if(o->n_inputs == 1) {
+        return is[0].exit_code;
+    }
+
+    int exit_code = 0;
+    for(const struct instance& i: is) {
+        dprintf(2, "%s: %d\n", i.input, i.exit_code);
+        if(exit_code == 0) {
+            exit_code = i.exit_code;
+        }
+    }
+    return exit_code;
+}
+
+static std::vector<std::string> node_args(char* argv0, struct options* o)
+{
+    char* c_args[] = {
+        argv0,
+        NULL,
+    };
+    const int n_args = 1;
+
+    uv_setup_args(n_args, c_args);
+    std::vector<std::string> args(c_args, c_args + n_args);
+
+    // NB: without the JIT there's no WebAssembly (and V8 warns about
+    // disabling it unless told not to expose it)
+    if(o->jitless) {
+        args.push_back("--jitless");
+        args.push_back("--no-expose-wasm");
+    }
 
-struct options {
-    const char* input;
+    // NB: V8's heap configuration applies to each isolate
+    if(o->max_old_space_mb > 0) {
+        args.push_back("--max-old-space-size=" + std::to_string(o->max_old_space_mb));
+    }
 
-    int allow_script_dir_read;
-    int allow_script_dir_exec;
+    if(o->max_semi_space_mb > 0) {
+        args.push_back("--max-semi-space-size=" + std::to_string(o->max_semi_space_mb));
+    }
 
-    struct rlimit_spec rlimits[RLIMIT_NLIMITS];
-};
+    return args;
+}
 
-static void print_usage(int fd, const char* prog)
+// stacked on filter.bpf in jitless mode: forbid executable mappings
+static constexpr seccompc::filter jitless_filter()
 {
-    dprintf(fd, "usage: %s [OPTION]... INPUT\n", prog);
-    dprintf(fd, "\n");
-    dprintf(fd, "options:\n");
-    dprintf(fd, "  -s       allow reading files beneath the input script's directory\n");
-    dprintf(fd, "  -x       allow executing files beneath the input script's directory (implies read access)\n");
-    dprintf(fd, "  -h       print this message\n");
-    dprintf(fd, "  -v       print version information\n");
-    dprintf(fd, "\n");
-    dprintf(fd, "rlimit options:\n");
-    dprintf(fd, "  -rRLIMIT=VALUE set RLIMIT to VALUE\n");
-    dprintf(fd, "  -R             use inherited rlimits instead of default\n");
+    using namespace seccompc;
+    return filter(AUDIT_ARCH_X86_64, ret::allow,
+        rule({ __NR_mmap, __NR_mprotect, __NR_pkey_mprotect },
+             arg(2) & PROT_EXEC, ret::kill_thread));
 }
 
-#include "version.c"
+// NB: seccomp(2) isn't allowed by filter.bpf, so this is to be applied first
+static void seccomp_apply_jitless_filter()
+{
+    auto filter = seccompc::assemble<jitless_filter>();
+    seccomp_install(filter.data(), filter.size());
+}
 
-static void parse_options(struct options* o, int argc, char* argv[])
+// a warm process's filter until it has its job (see warm.bpf.in): then
+// filter.bpf is stacked on it
+static void seccomp_apply_warm_filter()
 {
-    memset(o, 0, sizeof(*o));
+    struct sock_filter filter[] = {
+#include "filter.warm.bpfc"
+    };
+    seccomp_install(filter, LENGTH(filter));
+}
 
-    rlimit_default(o->rlimits, LENGTH(o->rlimits));
+static int open_output(const char* fn)
+{
+    int fd = open(fn, O_WRONLY|O_CREAT|O_TRUNC|O_CLOEXEC, 0644);
+    CHECK(fd, "open(%s)", fn);
+    return fd;
+}
 
-    int res;
-    while((res = getopt(argc, argv, "hvsxr:R")) != -1) {
-        switch(res) {
-        case 's':
-            o->allow_script_dir_read = 1;
-            break;
-        case 'x':
-            o->allow_script_dir_exec = 1;
-            break;
-        case 'r': {
-            int r = rlimit_parse(o->rlimits, LENGTH(o->rlimits), optarg);
-            if(r != 0) {
-                dprintf(1, "unable to parse rlimit: %s\n", optarg);
-                exit(1);
+// the landlock rules of the inputs (opening the profile outputs first)
+static int sandbox_rules(struct options* o)
+{
+    int rsfd = landlock_new_ruleset();
+
+    for(int i = 0; i < o->n_inputs; i++) {
+        const char* input = o->inputs[i];
+
+        if(o->allow_script_dir_read || o->allow_script_dir_exec) {
+            char buf[PATH_MAX];
+            char* path = realpath(input, buf);
+            CHECK_NOT(path, NULL, "realpath(%s)", input);
+
+            char* script_dir = dirname(path);
+
+            if(o->allow_script_dir_read || o->allow_script_dir_exec) {
+                debug("allowing read access beneath: %s", script_dir);
+                landlock_allow_read(rsfd, script_dir);
             }
-            break;
+
+            if(o->allow_script_dir_exec) {
+                debug("allowing execute access beneath: %s", script_dir);
+                landlock_allow(rsfd, script_dir, LANDLOCK_ACCESS_FS_EXECUTE);
+            }
+        } else {
+            debug("allowing read access: %s", input);
+            landlock_allow_read(rsfd, input);
         }
-        case 'R':
-            rlimit_inherit(o->rlimits, LENGTH(o->rlimits));
-            break;
-        case 'v':
-            print_version(argv[0]);
-            exit(0);
-        case 'h':
-        default:
-            print_usage(res == 'h' ? 1 : 2, argv[0]);
-            exit(res == 'h' ? 0 : 1);
+    }
+
+    if(o->code_cache_dir) {
+        if(o->code_cache_write) {
+            debug("allowing read and write access beneath: %s", o->code_cache_dir);
+            landlock_allow_read_write(rsfd, o->code_cache_dir);
+        } else {
+            debug("allowing read access beneath: %s", o->code_cache_dir);
+            landlock_allow_read(rsfd, o->code_cache_dir);
         }
     }
 
-    if(optind < argc) {
-        o->input = argv[optind];
-        debug("input: %s", o->input);
+    if(o->cpu_profile) {
+        o->cpu_profile_fd = open_output(o->cpu_profile);
+    }
 
-        struct stat st;
-        int r = stat(o->input, &st);
-        if(r == -1 && errno == ENOENT) {
-            dprintf(2, "error; unable to access input file: %s\n", o->input);
-            exit(1);
-        }
-        CHECK(r, "stat(%s)", o->input);
-    } else {
-        dprintf(2, "error: no input file specified\n");
-        print_usage(2, argv[0]);
-        exit(1);
+    if(o->heap_profile) {
+        o->heap_profile_fd = open_output(o->heap_profile);
     }
-}
 
-#if (NODE_MAJOR_VERSION >= 24)
-#include <cppgc/platform.h>
+    if(o->heap_snapshot) {
+        o->heap_snapshot_fd = open_output(o->heap_snapshot);
+    }
+
+#if (NODE_MAJOR_VERSION >= 19)
+    landlock_allow_read(rsfd, "/etc/ssl/openssl.cnf");
+#endif
+
+#if (NODE_MAJOR_VERSION == 18)
+    landlock_allow_read(rsfd, "/usr/share/nodejs");
+    landlock_allow_read(rsfd, "/usr/lib/ssl/openssl.cnf");
+#endif
+    timing_phase("landlock_rules");
 
-static int RunNodeInstance(
-        node::MultiIsolatePlatform* platform,
-        const std::vector<std::string>& args,
-        const std::vector<std::string>& exec_args,
-        struct options* o)
+    return rsfd;
+}
+
+static void sandbox(struct options* o)
 {
-    int exit_code = 0;
+    rlimit_apply(o->rlimits, LENGTH(o->rlimits));
+    timing_phase("rlimit_apply");
 
-    std::vector<std::string> errors;
-    auto setup = node::CommonEnvironmentSetup::Create(platform, &errors, args, exec_args);
+    int rsfd = sandbox_rules(o);
+    landlock_apply(rsfd);
+    int r = close(rsfd); CHECK(r, "close");
+    timing_phase("landlock_apply");
 
-    if (!setup) {
-        for(const std::string& err: errors) {
-            error("node environment setup error: %s", err.c_str());
-        }
-        return 1;
+    if(o->jitless) {
+        debug("applying the jitless filter");
+        seccomp_apply_jitless_filter();
     }
 
-    v8::Isolate* isolate = setup->isolate();
-    node::Environment* env = setup->env();
+    seccomp_apply_filter();
+    timing_phase("seccomp_apply_filter");
+}
+
+// the realpath of the warm process's code cache (-C), which its jobs may fill
+static char warm_code_cache_dir[PATH_MAX];
+
+// a warm process starts node (V8's platform threads and an isolate included)
+// before its job's options, and so its sandbox, are known: landlock restricts
+// the calling thread and the ones it starts later, so it's first sandboxed
+// by what doesn't depend on the job (filter.bpf and the syscalls of getting
+// the job, see warm.bpf.in, and reading files but writing only to its own
+// code cache and executing nothing) and then the job's landlock domain and
+// filter.bpf are stacked on it on the thread running the job
+static void warm_sandbox(struct options* o)
+{
+    int rsfd = landlock_new_ruleset();
+    landlock_allow_read(rsfd, "/");
 
-    {
-        v8::Locker locker(isolate);
-        v8::Isolate::Scope isolate_scope(isolate);
-        v8::HandleScope handle_scope(isolate);
+    if(o->code_cache_dir && o->code_cache_write) {
+        char* path = realpath(o->code_cache_dir, warm_code_cache_dir);
+        CHECK_NOT(path, NULL, "realpath(%s)", o->code_cache_dir);
+        debug("allowing read and write access beneath: %s", path);
+        landlock_allow_read_write(rsfd, path);
+    }
+    timing_phase("landlock_rules");
 
-        setup->context()->Global()->Set(setup->context(),
-            v8::String::NewFromUtf8(isolate, "input_script_filename").ToLocalChecked(),
-            v8::String::NewFromUtf8(isolate, o->input).ToLocalChecked()
-        ).Check();
+    landlock_apply(rsfd);
+    int r = close(rsfd); CHECK(r, "close");
+    timing_phase("landlock_apply");
 
-        v8::Context::Scope context_scope(setup->context());
+    if(o->jitless) {
+        debug("applying the jitless filter");
+        seccomp_apply_jitless_filter();
+    }
 
-        const char main_script_source_utf8[] = {
-#include "main.jsc"
-        };
+    seccomp_apply_warm_filter();
+    timing_phase("seccomp_apply_filter");
+}
 
-        debug("loading environment");
-        auto loadenv_ret = node::LoadEnvironment(env, main_script_source_utf8);
-        if(loadenv_ret.IsEmpty()) {
-            failwith("unable to load envionment");
+// wait for the job and stack its sandbox on the warm process's: the options
+// node and its isolate have been made with must be the warm process's, and
+// the job can't do what the warm process's sandbox doesn't allow
+static void warm_start(struct options* o)
+{
+    static struct warm_job job;
+    warm_wait_sandboxed(o->warm, &job);
+    timing_phase("warm_wait");
+
+    struct options w = *o;
+    parse_options(o, job.argc, job.argv);
+    if(o->warm >= 0) {
+        dprintf(2, "error: a job can't be warm\n");
+        exit(1);
+    }
+    if(o->jitless != w.jitless
+       || o->max_old_space_mb != w.max_old_space_mb
+       || o->max_semi_space_mb != w.max_semi_space_mb
+       || o->platform_threads != w.platform_threads
+       || o->no_snapshot != w.no_snapshot) {
+        dprintf(2, "error: the job's -j, -m, -y, -t and -n options must be the warm process's\n");
+        exit(1);
+    }
+    if(o->allow_script_dir_exec || o->cpu_profile || o->heap_profile || o->heap_snapshot) {
+        dprintf(2, "error: a warm process's job can't execute files or write profiles (-x, -P, -A, -H)\n");
+        exit(1);
+    }
+    if(o->code_cache_dir && o->code_cache_write) {
+        char buf[PATH_MAX];
+        char* path = realpath(o->code_cache_dir, buf);
+        if(path == NULL || strcmp(path, warm_code_cache_dir) != 0) {
+            dprintf(2, "error: a warm process's job can fill only the warm process's code cache (-C)\n");
+            exit(1);
         }
-
-        exit_code = node::SpinEventLoop(env).FromMaybe(1);
     }
+    timing_phase("parse_job");
 
-    node::Stop(env);
+    rlimit_apply(o->rlimits, LENGTH(o->rlimits));
+    timing_phase("rlimit_apply");
 
-    return exit_code;
+    int rsfd = sandbox_rules(o);
+    landlock_apply(rsfd);
+    int r = close(rsfd); CHECK(r, "close");
+    timing_phase("landlock_apply");
+
+    // NB: without TSYNC, so the platform's threads keep the warm filter
+    seccomp_apply_filter();
+    timing_phase("seccomp_apply_filter");
 }
 
-static int run(int argc, char* argv[], struct options* o)
+// make the host's isolate and then wait for the job
+static void warm_host(struct host* h, struct vm* vm)
 {
-    char* c_args[] = {
-        argv[0],
-        NULL,
-    };
-    const int n_args = 1;
+    vm_init(vm, h);
+    timing_phase("vm_init");
 
-    argv = uv_setup_args(n_args, c_args);
-    std::vector<std::string> args(c_args, c_args + n_args);
+    warm_start(h->o);
+
+    vm->allocator->set_budget((size_t)h->o->array_buffer_budget_mb << 20);
+    h->vm = vm;
+}
+
+#if (NODE_MAJOR_VERSION >= 24)
+#include <cppgc/platform.h>
+
+static int run(int argc, char* argv[], struct options* o)
+{
+    std::vector<std::string> args = node_args(argv[0], o);
 
     auto result = node::InitializeOncePerProcess(
         args, {
@@ -176,19 +1991,40 @@ static int run(int argc, char* argv[], struct options* o)
     if(result->early_return() != 0) {
         return result->exit_code();
     }
+    timing_phase("node_init");
 
-    debug("initializing node platform");
-    auto platform = node::MultiIsolatePlatform::Create(1);
+    debug("initializing node platform: threads=%d", o->platform_threads);
+    auto platform = node::MultiIsolatePlatform::Create(o->platform_threads);
     v8::V8::InitializePlatform(platform.get());
     cppgc::InitializeProcess(platform->GetPageAllocator());
     v8::V8::Initialize();
 
-    int ret = RunNodeInstance(platform.get(), result->args(), result->exec_args(), o);
+    // NB: the snapshot must outlive the isolates created from it
+    auto snapshot = load_snapshot(o);
+    timing_phase("v8_init");
+
+    struct host h;
+    h.platform = platform.get();
+    h.args = result->args();
+    h.exec_args = result->exec_args();
+    h.snapshot = snapshot.get();
+    h.o = o;
+
+    struct vm warm;
+    if(o->warm >= 0) {
+        warm_host(&h, &warm);
+    }
+
+    int ret = run_inputs(&h);
+    timing_phase("run");
+
+    snapshot.reset();
 
     v8::V8::Dispose();
     v8::V8::DisposePlatform();
 
     node::TearDownOncePerProcess();
+    timing_phase("teardown");
     return ret;
 }
 
@@ -196,14 +2032,7 @@ static int run(int argc, char* argv[], struct options* o)
 
 static int run(int argc, char* argv[], struct options* o)
 {
-    char* c_args[] = {
-        argv[0],
-        NULL,
-    };
-    const int n_args = 1;
-
-    argv = uv_setup_args(n_args, c_args);
-    std::vector<std::string> args(c_args, c_args + n_args);
+    std::vector<std::string> args = node_args(argv[0], o);
 #if (NODE_MAJOR_VERSION >= 18)
     auto result = node::InitializeOncePerProcess(
         args, {
@@ -232,149 +2061,46 @@ static int run(int argc, char* argv[], struct options* o)
 #else
 #error "unsupported node version"
 #endif
+    timing_phase("node_init");
 
-    debug("initializing node platform");
-    auto platform = node::MultiIsolatePlatform::Create(1);
+    debug("initializing node platform: threads=%d", o->platform_threads);
+    auto platform = node::MultiIsolatePlatform::Create(o->platform_threads);
     v8::V8::InitializePlatform(platform.get());
     v8::V8::Initialize();
 
-    debug("initializing uv loop");
-    uv_loop_t loop;
-    int r = uv_loop_init(&loop);
-    CHECK_UV(r, "uv_loop_init");
-
-    debug("creating allocator");
-    auto allocator = node::ArrayBufferAllocator::Create();
-    if(allocator == nullptr) {
-        failwith("unable to create allocator");
-    }
-
-    debug("creating v8::Isolate");
-    auto isolate = node::NewIsolate(allocator.get(), &loop, platform.get());
-    if(isolate == nullptr) {
-        failwith("unable to create v8::Isolate");
-    }
-
-    int exit_code = 0;
-    {
-        v8::Locker locker(isolate);
-        v8::Isolate::Scope isolate_scope(isolate);
-
-        debug("creating node::IsolateData");
-        std::unique_ptr<node::IsolateData, decltype(&node::FreeIsolateData)>
-            isolate_data(
-                node::CreateIsolateData(isolate, &loop, platform.get()),
-                node::FreeIsolateData);
-
-        v8::HandleScope handle_scope(isolate);
-
-        auto context = node::NewContext(isolate);
-        if(context.IsEmpty()) {
-            failwith("unable to initialize v8::Context");
-        }
-
-        auto global = context->Global();
-        global->Set(context,
-#if (NODE_MAJOR_VERSION >= 18)
-            v8::String::NewFromUtf8(isolate, "input_script_filename").ToLocalChecked(),
-            v8::String::NewFromUtf8(isolate, o->input).ToLocalChecked()
-#elif (NODE_MAJOR_VERSION >= 12)
-            v8::String::NewFromUtf8(isolate, "input_script_filename"),
-            v8::String::NewFromUtf8(isolate, o->input)
-#else
-#error "unsupported node version"
+#if (NODE_MAJOR_VERSION >= 20)
+    // NB: the snapshot must outlive the isolates created from it
+    auto snapshot = load_snapshot(o);
 #endif
-        ).Check();
-
-        v8::Context::Scope context_scope(context);
+    timing_phase("v8_init");
 
-        debug("creating node::Environment");
-        std::unique_ptr<node::Environment, decltype(&node::FreeEnvironment)>
-            env(
-                node::CreateEnvironment(
-                    isolate_data.get(), context,
+    struct host h;
+    h.platform = platform.get();
 #if (NODE_MAJOR_VERSION >= 18)
-                    result->args(), result->exec_args()
+    h.args = result->args();
+    h.exec_args = result->exec_args();
 #elif (NODE_MAJOR_VERSION >= 12)
-                    args, exec_args
-#else
-#error "unsupported node version"
-#endif
-                ),
-                node::FreeEnvironment);
-        if(!env) {
-            failwith("unable to create environment");
-        }
-
-        const char main_script_source_utf8[] = {
-#include "main.jsc"
-        };
-
-        debug("loading environment");
-        auto loadenv_ret = node::LoadEnvironment(
-            env.get(), main_script_source_utf8);
-        if (loadenv_ret.IsEmpty()) {
-            failwith("unable to load envionment");
-        }
-
-        {
-            v8::SealHandleScope seal(isolate);
-            bool more;
-            do {
-                debug("running loop");
-                r = uv_run(&loop, UV_RUN_DEFAULT);
-                CHECK_UV(r, "uv_run");
-
-                debug("draining tasks");
-                platform->DrainTasks(isolate);
-
-                more = uv_loop_alive(&loop);
-                if(more) continue;
-
-                debug("emit before exit");
-#if (NODE_MAJOR_VERSION >= 18)
-                node::EmitProcessBeforeExit(env.get());
-#elif (NODE_MAJOR_VERSION == 12)
-                node::EmitBeforeExit(env.get());
+    h.args = args;
+    h.exec_args = exec_args;
 #else
 #error "unsupported node version"
 #endif
-
-                more = uv_loop_alive(&loop);
-            } while(more);
-        }
-
-        debug("emit exit");
-#if (NODE_MAJOR_VERSION >= 18)
-        exit_code = node::EmitProcessExit(env.get()).FromJust();
-#elif (NODE_MAJOR_VERSION == 12)
-        exit_code = node::EmitExit(env.get());
-#else
-#error "unsupported node version"
+#if (NODE_MAJOR_VERSION >= 20)
+    h.snapshot = snapshot.get();
 #endif
+    h.o = o;
 
-        debug("stopping env");
-        node::Stop(env.get());
+    struct vm warm;
+    if(o->warm >= 0) {
+        warm_host(&h, &warm);
     }
 
-    debug("disposing isolate");
-    bool platform_finished = false;
-    platform->AddIsolateFinishedCallback(isolate, [](void* data) {
-        debug("callbacking");
-        *static_cast<bool*>(data) = true;
-    }, &platform_finished);
-    platform->UnregisterIsolate(isolate);
-    isolate->Dispose();
-
-    while(!platform_finished) {
-        debug("waiting for platform to finish");
-        r = uv_run(&loop, UV_RUN_ONCE);
-        CHECK_UV(r, "uv_run");
-    }
+    int exit_code = run_inputs(&h);
+    timing_phase("run");
 
-    debug("closing loop");
-    r = uv_loop_close(&loop);
-    CHECK_UV(r, "uv_loop_close");
+#if (NODE_MAJOR_VERSION >= 20)
+    snapshot.reset();
+#endif
 
     debug("dispose v8");
     v8::V8::Dispose();
@@ -388,6 +2114,7 @@ static int run(int argc, char* argv[], struct options* o)
 #else
 #error "unsupported node version"
 #endif
+    timing_phase("teardown");
 
     debug("bye: %d", exit_code);
     return exit_code;
@@ -397,50 +2124,22 @@ static int run(int argc, char* argv[], struct options* o)
 
 int main(int argc, char* argv[])
 {
+    timing_init("hnode", BUILD_VERSION);
+
     drop_capabilities();
+    timing_phase("drop_capabilities");
     no_new_privs();
+    timing_phase("no_new_privs");
 
     struct options o;
     parse_options(&o, argc, argv);
+    timing_phase("parse_options");
 
-    rlimit_apply(o.rlimits, LENGTH(o.rlimits));
-
-    int rsfd = landlock_new_ruleset();
-
-    if(o.allow_script_dir_read || o.allow_script_dir_exec) {
-        char buf[PATH_MAX];
-        char* input = realpath(o.input, buf);
-        CHECK_NOT(input, NULL, "realpath(%s)", o.input);
-
-        char* script_dir = dirname(input);
-
-        if(o.allow_script_dir_read || o.allow_script_dir_exec) {
-            debug("allowing read access beneath: %s", script_dir);
-            landlock_allow_read(rsfd, script_dir);
-        }
-
-        if(o.allow_script_dir_exec) {
-            debug("allowing execute access beneath: %s", script_dir);
-            landlock_allow(rsfd, script_dir, LANDLOCK_ACCESS_FS_EXECUTE);
-        }
+    if(o.warm < 0) {
+        sandbox(&o);
     } else {
-        debug("allowing read access: %s", o.input);
-        landlock_allow_read(rsfd, o.input);
+        warm_sandbox(&o);
     }
 
-#if (NODE_MAJOR_VERSION >= 19)
-    landlock_allow_read(rsfd, "/etc/ssl/openssl.cnf");
-#endif
-
-#if (NODE_MAJOR_VERSION == 18)
-    landlock_allow_read(rsfd, "/usr/share/nodejs");
-    landlock_allow_read(rsfd, "/usr/lib/ssl/openssl.cnf");
-#endif
-
-    landlock_apply(rsfd);
-    int r = close(rsfd); CHECK(r, "close");
-
-    seccomp_apply_filter();
-
     return run(argc, argv, &o);
 }
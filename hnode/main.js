@@ -1,8 +1,165 @@
 const fs = require('fs');
 const vm = require('vm');
+const v8 = require('v8');
 
-globalThis.require = require('module').createRequire(process.cwd() + '/');
+// V8 code cache kept in code_cache_dir: entries are keyed by the filename
+// and source they were compiled from, produced after the script has run (to
+// include lazily compiled functions) and only written when the host allowed
+// it (code_cache_write).
+function code_cache(dir, write) {
+    const crypto = require('crypto');
+    const path = require('path');
 
-fs.readFile(input_script_filename, 'utf8', function(err, data) {
-    new vm.Script(data, { filename: input_script_filename }).runInThisContext();
-});
+    const pending = [];
+
+    if(write) {
+        process.on('exit', function() {
+            for(const [fn, script] of pending) {
+                fs.writeFileSync(fn, script.createCachedData());
+            }
+        });
+    }
+
+    return function compile(source, filename) {
+        const key = crypto.createHash('sha256')
+            .update(filename).update('\0').update(source).digest('hex');
+        const fn = path.join(dir, key);
+
+        let cachedData;
+        try {
+            cachedData = fs.readFileSync(fn);
+        } catch(e) {
+            if(e.code !== 'ENOENT') throw e;
+        }
+
+        const script = new vm.Script(source, { filename, cachedData });
+        if(write && (cachedData === undefined || script.cachedDataRejected)) {
+            pending.push([fn, script]);
+        }
+        return script;
+    };
+}
+
+// compile CommonJS modules loaded through require using compile: node's
+// _compile is kept (and with it the module's require, require.main and so
+// on) but given a stub calling the function compiled here in place of the
+// module's source
+function cache_modules(compile) {
+    const Module = require('module');
+    const _compile = Module.prototype._compile;
+    const compiled = Symbol.for('hnode.compiled');
+    const stub = 'const f = module[Symbol.for("hnode.compiled")];'
+        + ' delete module[Symbol.for("hnode.compiled")];'
+        + ' return f.apply(this, arguments);';
+
+    Module.prototype._compile = function(content, filename) {
+        if(content.startsWith('#!')) {
+            content = '//' + content;
+        }
+
+        this[compiled] = compile(Module.wrap(content), filename).runInThisContext();
+        return _compile.call(this, stub, filename);
+    };
+}
+
+// cache the native code of WebAssembly modules compiled through
+// WebAssembly.compile and WebAssembly.instantiate in dir, keyed by V8's
+// version and the module's bytes (not of the ones compiled by the
+// WebAssembly.Module constructor: V8 only uses cached native code when
+// compiling asynchronously)
+function cache_wasm(dir, write) {
+    const crypto = require('crypto');
+    const path = require('path');
+
+    wasm_streaming_install();
+    const serialize = wasm_module_serialize;
+    delete globalThis.wasm_streaming_install;
+    delete globalThis.wasm_module_serialize;
+
+    const pending = [];
+
+    if(write) {
+        process.on('exit', function() {
+            for(const [fn, module] of pending) {
+                const buf = serialize(module);
+                if(buf.byteLength > 0) {
+                    fs.writeFileSync(fn, new Uint8Array(buf));
+                }
+            }
+        });
+    }
+
+    const { compileStreaming, instantiate } = WebAssembly;
+
+    WebAssembly.compile = async function(source) {
+        if(source instanceof ArrayBuffer) {
+            source = new Uint8Array(source);
+        } else if(!ArrayBuffer.isView(source)) {
+            throw new TypeError('WebAssembly.compile(): Argument 0 must be a buffer source');
+        }
+
+        const key = crypto.createHash('sha256')
+            .update(process.versions.v8).update('\0').update(source).digest('hex');
+        const fn = path.join(dir, key + '.wasm');
+
+        let cached;
+        try {
+            cached = fs.readFileSync(fn);
+        } catch(e) {
+            if(e.code !== 'ENOENT') throw e;
+        }
+
+        const module = await compileStreaming({ bytes: source, cached });
+        if(write && cached === undefined) {
+            pending.push([fn, module]);
+        }
+        return module;
+    };
+
+    WebAssembly.instantiate = async function(source, imports) {
+        if(source instanceof WebAssembly.Module) {
+            return instantiate(source, imports);
+        }
+
+        const module = await WebAssembly.compile(source);
+        return { module, instance: await instantiate(module, imports) };
+    };
+}
+
+function main() {
+    globalThis.require = require('module').createRequire(process.cwd() + '/');
+
+    // the host compiles the input script itself, streaming it, unless it's to
+    // go through the code cache (which V8 doesn't consume when streaming)
+    if(typeof run_input_script === 'function') {
+        const run = run_input_script;
+        delete globalThis.run_input_script;
+        process.nextTick(run);
+        return;
+    }
+
+    let compile = function(source, filename) {
+        return new vm.Script(source, { filename });
+    };
+
+    if(typeof code_cache_dir === 'string') {
+        compile = code_cache(code_cache_dir, code_cache_write);
+        cache_modules(compile);
+
+        // NB: there's no WebAssembly without the JIT (-j)
+        if(typeof WebAssembly === 'object'
+           && typeof wasm_streaming_install === 'function') {
+            cache_wasm(code_cache_dir, code_cache_write);
+        }
+    }
+
+    fs.readFile(input_script_filename, 'utf8', function(err, data) {
+        compile(data, input_script_filename).runInThisContext();
+    });
+}
+
+if(v8.startupSnapshot && v8.startupSnapshot.isBuildingSnapshot()) {
+    v8.startupSnapshot.setDeserializeMainFunction(main);
+} else {
+    main();
+}
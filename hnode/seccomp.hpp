@@ -0,0 +1 @@
+../build/seccomp.hpp
\ No newline at end of file
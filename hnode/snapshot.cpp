@@ -0,0 +1,163 @@
+#include <node.h>
+#include <uv.h>
+
+#define LIBR_IMPLEMENTATION
+#include "r.h"
+
+// Build-time helper: bootstraps node, runs main.js up to the point where it
+// registers its deserialize main function and writes the resulting startup
+// snapshot blob to OUTPUT. An empty OUTPUT signals that no snapshot is
+// available (unsupported node version or a libnode built with a shared
+// read-only heap), in which case hnode bootstraps as usual.
+
+static void write_blob(const char* output, const char* buf, size_t len)
+{
+    int fd = open(output, O_WRONLY|O_CREAT|O_TRUNC|O_CLOEXEC, 0644);
+    CHECK(fd, "open(%s)", output);
+
+    while(len > 0) {
+        ssize_t s = write(fd, buf, len);
+        CHECK(s, "write(%s)", output);
+        buf += s;
+        len -= s;
+    }
+
+    int r = close(fd); CHECK(r, "close(%s)", output);
+}
+
+#if (NODE_MAJOR_VERSION >= 20)
+
+#if (NODE_MAJOR_VERSION >= 24)
+#include <cppgc/platform.h>
+#endif
+
+static int build_snapshot(
+        node::MultiIsolatePlatform* platform,
+        const std::vector<std::string>& args,
+        const std::vector<std::string>& exec_args,
+        const char* output)
+{
+    std::vector<std::string> errors;
+    auto setup = node::CommonEnvironmentSetup::CreateForSnapshotting(
+        platform, &errors, args, exec_args);
+    if(!setup) {
+        for(const std::string& err: errors) {
+            error("node environment setup error: %s", err.c_str());
+        }
+        return 1;
+    }
+
+    v8::Isolate* isolate = setup->isolate();
+    node::Environment* env = setup->env();
+
+    {
+        v8::Locker locker(isolate);
+        v8::Isolate::Scope isolate_scope(isolate);
+        v8::HandleScope handle_scope(isolate);
+        v8::Context::Scope context_scope(setup->context());
+
+        const char main_script_source_utf8[] = {
+#include "main.jsc"
+        };
+
+        debug("loading environment");
+        auto loadenv_ret = node::LoadEnvironment(env, main_script_source_utf8);
+        if(loadenv_ret.IsEmpty()) {
+            failwith("unable to load envionment");
+        }
+
+        int exit_code = node::SpinEventLoop(env).FromMaybe(1);
+        if(exit_code != 0) {
+            error("snapshot builder exited with: %d", exit_code);
+            return exit_code;
+        }
+    }
+
+    debug("creating snapshot");
+    auto snapshot = setup->CreateSnapshot();
+    if(!snapshot) {
+        failwith("unable to create snapshot");
+    }
+
+    std::vector<char> blob = snapshot->ToBlob();
+    info("snapshot size: %zu", blob.size());
+    write_blob(output, blob.data(), blob.size());
+
+    return 0;
+}
+
+static int run(int argc, char* argv[], const char* output)
+{
+    char* c_args[] = {
+        argv[0],
+        NULL,
+    };
+    const int n_args = 1;
+
+    argv = uv_setup_args(n_args, c_args);
+    std::vector<std::string> args(c_args, c_args + n_args);
+
+    auto result = node::InitializeOncePerProcess(
+        args, {
+            node::ProcessInitializationFlags::kNoInitializeV8,
+            node::ProcessInitializationFlags::kNoInitializeNodeV8Platform,
+            node::ProcessInitializationFlags::kDisableNodeOptionsEnv,
+#if (NODE_MAJOR_VERSION >= 24)
+            node::ProcessInitializationFlags::kNoInitializeCppgc,
+#endif
+        });
+
+    for(const std::string& err: result->errors()) {
+        error("node initialization error: %s", err.c_str());
+    }
+
+    if(result->early_return() != 0) {
+        return result->exit_code();
+    }
+
+    if(!node::EmbedderSnapshotData::CanUseCustomSnapshotPerIsolate()) {
+        warning("libnode does not support custom snapshots: writing an empty snapshot");
+        node::TearDownOncePerProcess();
+        write_blob(output, NULL, 0);
+        return 0;
+    }
+
+    debug("initializing node platform");
+    auto platform = node::MultiIsolatePlatform::Create(1);
+    v8::V8::InitializePlatform(platform.get());
+#if (NODE_MAJOR_VERSION >= 24)
+    cppgc::InitializeProcess(platform->GetPageAllocator());
+#endif
+    v8::V8::Initialize();
+
+    int ret = build_snapshot(platform.get(),
+        result->args(), result->exec_args(), output);
+
+    v8::V8::Dispose();
+    v8::V8::DisposePlatform();
+
+    node::TearDownOncePerProcess();
+    return ret;
+}
+
+#else // NODE_MAJOR_VERSION >= 20
+
+static int run(int argc, char* argv[], const char* output)
+{
+    warning("node %d does not support embedder snapshots: writing an empty snapshot",
+            NODE_MAJOR_VERSION);
+    write_blob(output, NULL, 0);
+    return 0;
+}
+
+#endif // NODE_MAJOR_VERSION >= 20
+
+int main(int argc, char* argv[])
+{
+    if(argc != 2) {
+        dprintf(2, "usage: %s OUTPUT\n", argv[0]);
+        exit(1);
+    }
+
+    return run(argc, argv, argv[1]);
+}
@@ -0,0 +1,8 @@
+try {
+    Buffer.alloc(32 << 20);
+    console.log("allocated");
+} catch(e) {
+    console.log(e.name);
+}
+
+console.log(Buffer.alloc(1 << 20).length);
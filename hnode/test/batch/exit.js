@@ -0,0 +1 @@
+process.exit(3);
@@ -0,0 +1,2 @@
+globalThis.leaked = true;
+console.log("hello");
@@ -0,0 +1,23 @@
+#!/bin/bash
+# check.sh HNODE: run main.js with the cache prepare.sh filled and check that
+# its entries are used: a rejected entry would be written again
+
+set -o nounset -o pipefail -o errexit
+
+entries() {
+    find cache -type f -printf '%f %s %T@\n' | sort
+}
+
+BEFORE=$(entries)
+N=$(wc -l <<< "$BEFORE")
+if [ "$N" != 2 ]; then
+    echo "expected cache entries for main.js and lib.js, found $N" >&2
+    exit 1
+fi
+
+"$1" -s -C cache main.js
+
+if [ "$(entries)" != "$BEFORE" ]; then
+    echo "cache entries rejected (and written again)" >&2
+    exit 1
+fi
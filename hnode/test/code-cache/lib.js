@@ -0,0 +1,3 @@
+module.exports.hello = function() {
+    console.log("hello");
+};
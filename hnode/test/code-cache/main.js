@@ -0,0 +1 @@
+require("./lib.js").hello()
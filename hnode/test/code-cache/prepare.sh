@@ -0,0 +1,8 @@
+#!/bin/bash
+# prepare.sh HNODE: fill the cache (with entries for main.js and lib.js)
+
+set -o nounset -o pipefail -o errexit
+
+rm -rf cache
+mkdir cache
+"$1" -s -C cache main.js > /dev/null
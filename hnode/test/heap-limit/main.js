@@ -0,0 +1,4 @@
+const xs = [];
+while(true) {
+    xs.push(new Array(1024).fill(xs.length));
+}
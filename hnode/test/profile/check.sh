@@ -0,0 +1,19 @@
+#!/bin/bash
+# check.sh HNODE: run main.js with all the profiles and check that they're
+# written and are what the devtools expect
+
+set -o nounset -o pipefail -o errexit
+
+rm -f main.cpuprofile main.heapprofile main.heapsnapshot
+
+"$1" -P main.cpuprofile -A main.heapprofile -H main.heapsnapshot main.js
+
+python3 - <<PY
+import json, sys
+for fn, key in [ ("main.cpuprofile", "nodes"),
+                 ("main.heapprofile", "head"),
+                 ("main.heapsnapshot", "snapshot") ]:
+    with open(fn) as f:
+        if key not in json.load(f):
+            sys.exit(f"{fn}: no {key}")
+PY
@@ -0,0 +1,10 @@
+function fib(n) {
+    return n < 2 ? n : fib(n - 1) + fib(n - 2);
+}
+
+const xs = [];
+for(let i = 0; i < 1000; i++) {
+    xs.push({ i, s: String(i).repeat(16) });
+}
+
+console.log(fib(25), xs.length);
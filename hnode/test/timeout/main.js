@@ -0,0 +1,6 @@
+process.on('exit', function() {
+    console.log("exit");
+});
+
+setInterval(function() {}, 1000);
+while(true) {}
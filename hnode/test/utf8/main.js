@@ -0,0 +1,2 @@
+const s = "höj 🚀";
+console.log(s, s.length);
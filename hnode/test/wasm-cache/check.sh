@@ -0,0 +1,13 @@
+#!/bin/bash
+# check.sh HNODE: check that prepare.sh cached the module and run main.js
+# with the (read-only) cache
+
+set -o nounset -o pipefail -o errexit
+
+N=$(find cache -name '*.wasm' -size +0 | wc -l)
+if [ "$N" != 1 ]; then
+    echo "expected a cached module, found $N" >&2
+    exit 1
+fi
+
+"$1" -c cache main.js
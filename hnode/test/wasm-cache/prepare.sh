@@ -0,0 +1,8 @@
+#!/bin/bash
+# prepare.sh HNODE: fill the cache (with the module's native code)
+
+set -o nounset -o pipefail -o errexit
+
+rm -rf cache
+mkdir cache
+"$1" -C cache main.js > /dev/null
@@ -0,0 +1,9 @@
+#!/bin/bash
+
+# run the command with the dentry and inode caches dropped (needs root)
+
+set -o nounset -o pipefail -o errexit
+
+sync
+echo 2 > /proc/sys/vm/drop_caches
+exec "$@"
@@ -0,0 +1,9 @@
+#!/bin/bash
+
+set -o nounset -o pipefail -o errexit
+
+gcc -Wall -Werror -O2 -o ruleset ruleset.c
+
+# the shared libraries and Python modules the rules would typically be for
+find /usr/lib -maxdepth 3 -type f \( -name '*.so*' -o -name '*.py' \) 2>/dev/null \
+    | xargs realpath | sort -u | sed -n '1,512p' > files
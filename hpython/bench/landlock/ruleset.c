@@ -0,0 +1,61 @@
+// build a landlock ruleset granting read access to the first N paths of
+// FILES, either a landlock_allow per path or batched with
+// landlock_allow_rules, and report the time it took
+//
+// usage: ruleset [-b] N FILES
+
+#define LIBR_IMPLEMENTATION
+#include "../../r.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+int main(int argc, char* argv[])
+{
+    int batched = argc > 1 && strcmp(argv[1], "-b") == 0;
+    if(argc != 3 + batched) {
+        dprintf(2, "usage: %s [-b] N FILES\n", argv[0]);
+        return 2;
+    }
+    size_t n = strtoul(argv[1 + batched], NULL, 10);
+
+    FILE* f = fopen(argv[2 + batched], "r");
+    CHECK_NOT(f, NULL, "fopen(%s)", argv[2 + batched]);
+
+    struct landlock_rule* rules = calloc(n, sizeof(*rules));
+    CHECK_MALLOC(rules);
+
+    char* line = NULL;
+    size_t len = 0, i = 0;
+    for(; i < n && getline(&line, &len, f) > 0; i++) {
+        line[strcspn(line, "\n")] = '\0';
+        rules[i].path = strdup(line);
+        rules[i].allowed_access = LANDLOCK_ACCESS_FS_READ_FILE;
+    }
+    if(i < n) {
+        failwith("not enough paths: %zu < %zu", i, n);
+    }
+
+    struct timespec t0, t1;
+    int r = clock_gettime(CLOCK_MONOTONIC, &t0);
+    CHECK(r, "clock_gettime");
+
+    int rsfd = landlock_new_ruleset();
+    if(batched) {
+        landlock_allow_rules(rsfd, rules, n);
+    } else {
+        for(i = 0; i < n; i++) {
+            landlock_allow(rsfd, rules[i].path, rules[i].allowed_access);
+        }
+    }
+
+    r = clock_gettime(CLOCK_MONOTONIC, &t1);
+    CHECK(r, "clock_gettime");
+
+    printf("{\"ruleset\": %.9f}\n",
+        (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9);
+
+    return 0;
+}
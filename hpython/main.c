@@ -19,6 +19,9 @@ struct options {
     const char* input;
 
     struct rlimit_spec rlimits[RLIMIT_NLIMITS];
+
+    // the socket to wait for the job on (see warm_wait)
+    int warm;
 };
 
 static void print_usage(int fd, const char* prog)
@@ -26,6 +29,7 @@ static void print_usage(int fd, const char* prog)
     dprintf(fd, "usage: %s [OPTION]... INPUT\n", prog);
     dprintf(fd, "\n");
     dprintf(fd, "options:\n");
+    dprintf(fd, "  -W FD    initialize and then wait for the job on the socket FD (see hsup)\n");
     dprintf(fd, "  -h       print this message\n");
     dprintf(fd, "\n");
     dprintf(fd, "rlimit options:\n");
@@ -40,10 +44,18 @@ static void parse_options(struct options* o, int argc, char* argv[])
     memset(o, 0, sizeof(*o));
 
     rlimit_default(o->rlimits, LENGTH(o->rlimits));
+    o->warm = -1;
 
     int res;
-    while((res = getopt(argc, argv, "hvr:R")) != -1) {
+    while((res = getopt(argc, argv, "hvW:r:R")) != -1) {
         switch(res) {
+        case 'W':
+            o->warm = warm_parse_fd(optarg);
+            if(o->warm < 0) {
+                dprintf(2, "error: invalid file descriptor: %s\n", optarg);
+                exit(1);
+            }
+            break;
         case 'r': {
             int r = rlimit_parse(o->rlimits, LENGTH(o->rlimits), optarg);
             if(r != 0) {
@@ -65,6 +77,11 @@ static void parse_options(struct options* o, int argc, char* argv[])
         }
     }
 
+    if(o->warm >= 0) {
+        // the input comes with the job
+        return;
+    }
+
     if(optind < argc) {
         o->input = argv[optind];
         debug("input: %s", o->input);
@@ -95,44 +112,80 @@ static void parse_options(struct options* o, int argc, char* argv[])
 } while(0)
 
 
+static void initialize(const char* prog)
+{
+    PyPreConfig preconfig;
+    PyPreConfig_InitIsolatedConfig(&preconfig);
+    PyStatus s = Py_PreInitialize(&preconfig);
+    CHECK_PYTHON(s, "Py_PreInitialize");
+
+    PyConfig config;
+    PyConfig_InitIsolatedConfig(&config);
+
+    config.program_name = Py_DecodeLocale(prog, NULL);
+    CHECK_NOT(config.program_name, NULL, "Py_DecodeLocale(%s)", prog);
+
+    s = Py_InitializeFromConfig(&config);
+    CHECK_PYTHON(s, "Py_InitializeFromConfig");
+    PyConfig_Clear(&config);
+    PyMem_RawFree(config.program_name);
+}
+
 int main(int argc, char* argv[])
 {
+    timing_init("hpython", BUILD_VERSION);
+
     drop_capabilities();
+    timing_phase("drop_capabilities");
     no_new_privs();
+    timing_phase("no_new_privs");
 
     struct options o;
     parse_options(&o, argc, argv);
+    timing_phase("parse_options");
+
+    // a warm process initializes the interpreter before its job's options
+    // (and so its sandbox) are known
+    struct warm_job job;
+    if(o.warm >= 0) {
+        initialize(argv[0]);
+        timing_phase("init");
+
+        warm_wait(o.warm, &job);
+        timing_phase("warm_wait");
+
+        parse_options(&o, job.argc, job.argv);
+        if(o.warm >= 0) {
+            dprintf(2, "error: a job can't be warm\n");
+            exit(1);
+        }
+        timing_phase("parse_job");
+    }
 
     rlimit_apply(o.rlimits, LENGTH(o.rlimits));
+    timing_phase("rlimit_apply");
 
     int rsfd = landlock_new_ruleset();
     landlock_allow_read(rsfd, o.input);
 #include "landlock.filesc"
+    timing_phase("landlock_rules");
 
     landlock_apply(rsfd);
     int r = close(rsfd); CHECK(r, "close");
+    timing_phase("landlock_apply");
 
     seccomp_apply_filter();
+    timing_phase("seccomp_apply_filter");
 
-    PyPreConfig preconfig;
-    PyPreConfig_InitIsolatedConfig(&preconfig);
-    PyStatus s = Py_PreInitialize(&preconfig);
-    CHECK_PYTHON(s, "Py_PreInitialize");
-
-    PyConfig config;
-    PyConfig_InitIsolatedConfig(&config);
-
-    config.program_name = Py_DecodeLocale(argv[0], NULL);
-    CHECK_NOT(config.program_name, NULL, "Py_DecodeLocale(%s)", argv[0]);
-
-    s = Py_InitializeFromConfig(&config);
-    CHECK_PYTHON(s, "Py_InitializeFromConfig");
-    PyConfig_Clear(&config);
-    PyMem_RawFree(config.program_name);
+    if(!Py_IsInitialized()) {
+        initialize(argv[0]);
+        timing_phase("init");
+    }
 
     debug("opening input file: %s", o.input);
     FILE* f = fopen(o.input, "r");
     CHECK_NOT(f, NULL, "fopen(%s, r)", o.input);
+    timing_phase("load");
 
     debug("running file: %s", o.input);
     r = PyRun_SimpleFileExFlags(f, o.input, /*closeit*/ 1, NULL);
@@ -142,9 +195,11 @@ int main(int argc, char* argv[])
     } else {
         CHECK_NOT(r, -1, "PyRun_SimpleFileExFlags(%s)", o.input);
     }
+    timing_phase("run");
 
     Py_FinalizeEx();
     CHECK_NOT(r, -1, "Py_FinalizeEx()");
+    timing_phase("teardown");
 
     return 0;
 }
@@ -0,0 +1,25 @@
+#!/bin/bash
+# generate the log processing scripts, each carrying (as comments) the access
+# log it extracts the request paths from
+
+set -o nounset -o pipefail -o errexit
+
+log() {
+    for i in $(seq 2000); do
+        echo "# 10.0.$((i % 256)).$((i % 7)) - - [19/Oct/2026:12:00:00 +0000] \"GET /page/$((i % 97)) HTTP/1.1\" 200 $((i * 13 % 4096))"
+    done
+}
+
+LOG=$(log)
+
+cat > bash.sh <<SCRIPT
+while read -r _ _ _ _ _ _ _ path _; do
+    echo "\$path"
+done < "\$0"
+$LOG
+SCRIPT
+
+cat > loadables.sh <<SCRIPT
+cut -d ' ' -f 8 "\$0"
+$LOG
+SCRIPT
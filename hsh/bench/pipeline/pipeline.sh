@@ -0,0 +1,15 @@
+produce() {
+    for ((i = 0; i < 20000; i++)); do
+        echo "line $i"
+    done
+}
+
+consume() {
+    local n=0
+    while read -r _ x; do
+        n=$((n + x % 7))
+    done
+    echo "$n"
+}
+
+produce | consume
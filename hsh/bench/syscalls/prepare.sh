@@ -0,0 +1,9 @@
+#!/bin/bash
+
+set -o nounset -o pipefail -o errexit
+
+make -C ../.. EXE=hsh-split SECCOMP_SPLIT=1 build
+make -C ../.. EXE=hsh-spec-allow SECCOMP_SPEC_ALLOW=1 build
+
+mkdir -p data
+seq 1 20000 > data/lines
@@ -0,0 +1,7 @@
+# bash reads a regular file a chunk at a time and seeks back to the end of
+# the line: two syscalls per line
+n=0
+while read -r x; do
+    n=$((n + x))
+done < "$TMPDIR/lines"
+echo "$n"
@@ -0,0 +1,68 @@
+#include <asm/unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/sched.h>
+#include <signal.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+
+constexpr seccompc::filter seccomp_filter()
+{
+    using namespace seccompc;
+    return filter(AUDIT_ARCH_X86_64, ret::kill_thread,
+        allow(__NR_brk),
+        allow_if(__NR_mmap, arg(3) & MAP_PRIVATE),
+        allow(__NR_mprotect, __NR_munmap),
+
+        allow(__NR_execveat, __NR_execve),
+
+        allow(__NR_getuid, __NR_getgid, __NR_geteuid, __NR_getegid,
+              __NR_getpid, __NR_getppid, __NR_getpgrp, __NR_gettid),
+
+        allow(__NR_openat, __NR_close, __NR_read, __NR_pread64,
+              __NR_write, __NR_writev, __NR_lseek, __NR_access,
+              __NR_newfstatat, __NR_fstat, __NR_dup, __NR_dup2, __NR_dup3,
+              __NR_pipe, __NR_pipe2, __NR_unlink, __NR_unlinkat,
+              __NR_readlink),
+
+        // TODO: restrict to AF_UNIX
+        allow(__NR_socket, __NR_connect),
+
+        allow(__NR_getrandom),
+
+        allow(__NR_rt_sigprocmask, __NR_rt_sigaction, __NR_rt_sigreturn,
+              __NR_rt_sigsuspend),
+
+        // a process or the own process group but not every process
+        // (pid -1) or another group (-pgid): the processes outside the
+        // sandbox are out of reach only with landlock's signal scoping
+        rule(__NR_kill, arg(0) <= 0x7fffffff, ret::allow, ret::err(EPERM)),
+
+        // subshells and pipelines: fork (glibc's fork) and vfork-style
+        // spawning (glibc's posix_spawn), the children inherit the landlock
+        // domain and this filter and their number is bounded by RLIMIT_NPROC
+        allow_if(__NR_clone,
+            arg(0) == (CLONE_CHILD_SETTID|CLONE_CHILD_CLEARTID|SIGCHLD)
+            || arg(0) == (CLONE_VM|CLONE_VFORK|SIGCHLD)),
+        allow(__NR_vfork, __NR_wait4),
+
+        // NB: clone3's flags are passed in a struct and can't be inspected:
+        // make glibc fall back to clone
+        rule(__NR_clone3, ret::err(ENOSYS)),
+
+        allow(__NR_arch_prctl, __NR_set_tid_address),
+        allow(__NR_sysinfo, __NR_uname),
+        allow(__NR_getcwd),
+        allow(__NR_set_robust_list, __NR_rseq),
+        allow(__NR_prlimit64),
+
+        allow_if(__NR_ioctl, arg(1) & TIOCGPGRP),
+
+        // NB: bash saves the file descriptors it redirects with F_DUPFD
+        allow_if(__NR_fcntl,
+            arg(1) == F_DUPFD || arg(1) == F_DUPFD_CLOEXEC
+            || arg(1) == F_GETFD || arg(1) == F_SETFD
+            || arg(1) == F_GETFL || arg(1) == F_SETFL),
+
+        allow(__NR_tgkill, __NR_exit_group));
+}
@@ -5,6 +5,8 @@
 #define RLIMIT_DEFAULT_STACK (1<<14)
 #define RLIMIT_DEFAULT_DATA (1<<19)
 #define RLIMIT_DEFAULT_AS (1<<23)
+#define RLIMIT_DEFAULT_FSIZE (1<<20)
+#define RLIMIT_DEFAULT_NPROC (1<<11)
 
 #define LIBR_IMPLEMENTATION
 #include "r.h"
@@ -12,15 +14,35 @@
 #include "seccomp.c"
 #include "capabilities.c"
 
-#ifndef DEFAULT_SHELL
-#define DEFAULT_SHELL "/bin/sh"
-#endif
+// a shell built in by the Makefile (see SHELLS), with the landlock rules
+// granting access to the libraries it links (and its loadable builtins)
+struct shell {
+    const char* name;
+    const char* path;
+    void (*landlock)(int rsfd);
+
+    // bash's loadable builtins (NULL-terminated) to enable before the
+    // script is run
+    const char* const* loadables;
+
+    // the shell's default RLIMIT_NOFILE if it needs more than
+    // RLIMIT_DEFAULT_NOFILE (0 otherwise): dash and busybox's ash move the
+    // script's descriptor to 10 or above
+    unsigned long nofile;
+};
+
+#include "shells.c"
 
 struct options {
     const char* input;
-    const char* shell;
+    const struct shell* shell;
+    int no_loadables;
+    const char* tmpdir;
 
     struct rlimit_spec rlimits[RLIMIT_NLIMITS];
+
+    // the socket to wait for the job on (see warm_wait)
+    int warm;
 };
 
 static void print_usage(int fd, const char* prog)
@@ -28,36 +50,82 @@ static void print_usage(int fd, const char* prog)
     dprintf(fd, "usage: %s [OPTION]... INPUT\n", prog);
     dprintf(fd, "\n");
     dprintf(fd, "options:\n");
+    dprintf(fd, "  -s NAME  run INPUT with the shell NAME (default %s)\n", shells[0].name);
+    dprintf(fd, "  -L       don't enable the shell's loadable builtins\n");
+    dprintf(fd, "  -t DIR   allow reading and writing files beneath DIR and use it as TMPDIR\n");
+    dprintf(fd, "  -W FD    prepare the shell's sandbox and then wait for the job on the socket FD (see hsup)\n");
     dprintf(fd, "  -h       print this message\n");
     dprintf(fd, "  -v       print version information\n");
     dprintf(fd, "\n");
     dprintf(fd, "rlimit options:\n");
     dprintf(fd, "  -rRLIMIT=VALUE set RLIMIT to VALUE\n");
     dprintf(fd, "  -R             use inherited rlimits instead of default\n");
+    dprintf(fd, "\n");
+    dprintf(fd, "shells:\n");
+    for(size_t i = 0; i < LENGTH(shells); i++) {
+        dprintf(fd, "  %-8s %s\n", shells[i].name, shells[i].path);
+    }
+}
+
+static const struct shell* find_shell(const char* name)
+{
+    for(size_t i = 0; i < LENGTH(shells); i++) {
+        if(strcmp(shells[i].name, name) == 0) {
+            return &shells[i];
+        }
+    }
+    return NULL;
 }
 
 #include "version.c"
 
-static void parse_options(struct options* o, int argc, char* argv[])
+static void parse_options(struct options* o, const struct shell* shell,
+                          int argc, char* argv[])
 {
     memset(o, 0, sizeof(*o));
-    o->shell = DEFAULT_SHELL;
+    o->shell = shell;
+    o->warm = -1;
 
     rlimit_default(o->rlimits, LENGTH(o->rlimits));
+    int nofile_given = 0;
 
     int res;
-    while((res = getopt(argc, argv, "hvr:R")) != -1) {
+    while((res = getopt(argc, argv, "hvs:Lt:W:r:R")) != -1) {
         switch(res) {
+        case 's':
+            o->shell = find_shell(optarg);
+            if(o->shell == NULL) {
+                dprintf(2, "error: unknown shell: %s\n", optarg);
+                exit(1);
+            }
+            break;
+        case 'L':
+            o->no_loadables = 1;
+            break;
+        case 't':
+            o->tmpdir = optarg;
+            break;
+        case 'W':
+            o->warm = warm_parse_fd(optarg);
+            if(o->warm < 0) {
+                dprintf(2, "error: invalid file descriptor: %s\n", optarg);
+                exit(1);
+            }
+            break;
         case 'r': {
             int r = rlimit_parse(o->rlimits, LENGTH(o->rlimits), optarg);
             if(r != 0) {
                 dprintf(1, "unable to parse rlimit: %s\n", optarg);
                 exit(1);
             }
+            if(strncasecmp(optarg, "NOFILE=", 7) == 0) {
+                nofile_given = 1;
+            }
             break;
         }
         case 'R':
             rlimit_inherit(o->rlimits, LENGTH(o->rlimits));
+            nofile_given = 1;
             break;
         case 'v':
             print_version(argv[0]);
@@ -69,6 +137,19 @@ static void parse_options(struct options* o, int argc, char* argv[])
         }
     }
 
+    if(o->shell->nofile > 0 && !nofile_given) {
+        for(size_t i = 0; i < LENGTH(o->rlimits); i++) {
+            if(o->rlimits[i].resource == RLIMIT_NOFILE) {
+                o->rlimits[i].value = o->shell->nofile;
+            }
+        }
+    }
+
+    if(o->warm >= 0) {
+        // the input comes with the job
+        return;
+    }
+
     if(optind < argc) {
         o->input = argv[optind];
         debug("input: %s", o->input);
@@ -87,25 +168,52 @@ static void parse_options(struct options* o, int argc, char* argv[])
     }
 }
 
+// the command enabling the loadable builtins and then sourcing the script
+// (which bash runs with the script as $0)
+static char* loadables_command(const char* const* loadables)
+{
+    const char* source = ". \"$0\"";
+
+    size_t len = strlen(source) + 1;
+    for(const char* const* l = loadables; *l; l++) {
+        len += strlen("enable -f  ; ") + 2*strlen(*l);
+    }
+
+    char* cmd = malloc(len); CHECK_MALLOC(cmd);
+    char* p = cmd;
+    for(const char* const* l = loadables; *l; l++) {
+        const char* name = strrchr(*l, '/');
+        p += sprintf(p, "enable -f %s %s; ", *l, name ? name + 1 : *l);
+    }
+    strcpy(p, source);
+
+    return cmd;
+}
+
 int main(int argc, char* argv[])
 {
+    timing_init("hsh", BUILD_VERSION);
+
     drop_capabilities();
+    timing_phase("drop_capabilities");
     no_new_privs();
+    timing_phase("no_new_privs");
 
     struct options o;
-    parse_options(&o, argc, argv);
-
-    rlimit_apply(o.rlimits, LENGTH(o.rlimits));
+    parse_options(&o, &shells[0], argc, argv);
+    timing_phase("parse_options");
 
-    int shell_fd = open(o.shell, __O_PATH);
-    CHECK(shell_fd, "open(%s, O_RDONLY)", o.shell);
+    // the shell's rules don't depend on the script: a warm process adds
+    // them before waiting for its job
+    const struct shell* sh = o.shell;
+    debug("shell: %s (%s)", sh->name, sh->path);
+    int shell_fd = open(sh->path, __O_PATH);
+    CHECK(shell_fd, "open(%s, O_RDONLY)", sh->path);
 
-    int rsfd = landlock_new_ruleset();
+    // subshells and pipelines signal their own processes only
+    int rsfd = landlock_new_scoped_ruleset(LANDLOCK_SCOPE_SIGNAL);
 
-    debug("allowing read access: %s", o.input);
-    landlock_allow_read(rsfd, o.input);
-
-    debug("allowing execute access: %s", o.shell);
+    debug("allowing execute access: %s", sh->path);
     struct landlock_path_beneath_attr shell_pb = {
         .allowed_access = LANDLOCK_ACCESS_FS_EXECUTE
             | LANDLOCK_ACCESS_FS_READ_FILE,
@@ -114,17 +222,66 @@ int main(int argc, char* argv[])
     int r = landlock_add_rule(rsfd, LANDLOCK_RULE_PATH_BENEATH, &shell_pb, 0);
     CHECK(r, "landlock_add_rule");
 
-#include "landlock.filesc"
+    sh->landlock(rsfd);
+    timing_phase("shell_rules");
+
+    struct warm_job job;
+    if(o.warm >= 0) {
+        warm_wait(o.warm, &job);
+        timing_phase("warm_wait");
+
+        parse_options(&o, sh, job.argc, job.argv);
+        if(o.warm >= 0) {
+            dprintf(2, "error: a job can't be warm\n");
+            exit(1);
+        }
+        if(o.shell != sh) {
+            dprintf(2, "error: the shell is %s\n", sh->name);
+            exit(1);
+        }
+        timing_phase("parse_job");
+    }
+
+    rlimit_apply(o.rlimits, LENGTH(o.rlimits));
+    timing_phase("rlimit_apply");
+
+    debug("allowing read access: %s", o.input);
+    landlock_allow_read(rsfd, o.input);
+
+    if(o.tmpdir) {
+        debug("allowing read-write access: %s", o.tmpdir);
+        landlock_allow_read_write(rsfd, o.tmpdir);
+    }
+    timing_phase("landlock_rules");
 
     landlock_apply(rsfd);
     r = close(rsfd); CHECK(r, "close");
+    timing_phase("landlock_apply");
 
     seccomp_apply_filter();
+    timing_phase("seccomp_apply_filter");
 
-    char* shell = strdup(o.shell); CHECK_MALLOC(shell);
+    // NB: busybox selects its applet by argv[0]
+    char* shell = strdup(o.shell->name); CHECK_MALLOC(shell);
     char* input = strdup(o.input); CHECK_MALLOC(input);
-    char* args[] = { shell, input, NULL, };
-    char* env[] = { NULL, };
+    char* args[] = { shell, input, NULL, NULL, NULL };
+    char* env[] = { NULL, NULL };
+    if(o.tmpdir) {
+        size_t n = strlen(o.tmpdir) + 8;
+        env[0] = malloc(n); CHECK_MALLOC(env[0]);
+        snprintf(env[0], n, "TMPDIR=%s", o.tmpdir);
+    }
+
+    if(o.shell->loadables && o.shell->loadables[0] && !o.no_loadables) {
+        args[1] = "-c";
+        args[2] = loadables_command(o.shell->loadables);
+        args[3] = input;
+        debug("running: %s", args[2]);
+    }
+
+    timing_phase("exec");
+    timing_write();
+    logger_flush();
 
     r = fexecve(shell_fd, args, env);
     CHECK(r, "fexecve");
@@ -1,5 +1,8 @@
-// libr 0.5.2 (20f582ad9ea9fd35f227a0044a599a66ddbd89fc) (https://github.com/rootmos/libr.git) (2025-05-09T09:57:00+02:00)
-// modules: fail logging now no_new_privs seccomp landlock rlimit util
+// based on libr 0.5.2 (20f582ad9ea9fd35f227a0044a599a66ddbd89fc) (https://github.com/rootmos/libr.git) (2025-05-09T09:57:00+02:00)
+// modules: fail logging now no_new_privs seccomp landlock rlimit util timing warm
+// local changes: logging buffers messages per thread, landlock adds
+// landlock_allow_rules and landlock_new_scoped_ruleset, timing and warm are
+// local modules
 
 #ifndef LIBR_HEADER
 #define LIBR_HEADER
@@ -113,6 +116,17 @@ void LIBR(vlogger)(
     va_list vl
 );
 
+// messages are formatted into a buffer per thread (of LOG_BUFFER_SIZE bytes,
+// 0 disables buffering) which is written when full, on the first message of
+// a new second, on messages of level LOG_WARNING and above, at thread exit
+// and at exit
+#ifndef LOG_BUFFER_SIZE
+#define LOG_BUFFER_SIZE 4096
+#endif
+
+// write the buffered messages of all threads (call before exec:ing)
+void LIBR(logger_flush)(void);
+
 // libr: now.h
 
 // returns current time formated as compact ISO8601: 20190123T182628Z
@@ -129,14 +143,38 @@ int LIBR(seccomp)(unsigned int operation, unsigned int flags, void *args);
 // libr: landlock.h
 
 #include <linux/types.h>
+#include <stddef.h>
 
 int LIBR(landlock_abi_version)(void);
 int LIBR(landlock_new_ruleset)(void);
+
+// scopes (landlock ABI 6, which the kernel headers may predate): restrict
+// signaling processes and connecting to abstract unix sockets outside the
+// landlock domain
+#define LANDLOCK_ABI_SCOPE 6
+#ifndef LANDLOCK_SCOPE_SIGNAL
+#define LANDLOCK_SCOPE_ABSTRACT_UNIX_SOCKET (1ULL << 0)
+#define LANDLOCK_SCOPE_SIGNAL (1ULL << 1)
+#endif
+
+// a ruleset (as landlock_new_ruleset) restricting the scopes as well, if the
+// kernel supports them
+int LIBR(landlock_new_scoped_ruleset)(__u64 scoped);
 void LIBR(landlock_allow)(int rsfd, const char* path, __u64 allowed_access);
 void LIBR(landlock_allow_read)(int fd, const char* path);
 void LIBR(landlock_allow_read_write)(int rsfd, const char* path);
 void LIBR(landlock_apply)(int fd);
 
+struct landlock_rule {
+    const char* path;
+    __u64 allowed_access;
+};
+
+// add rules, resolving each path relative to the directories of the
+// previous one's it shares (sort the rules by path to make the most of it)
+void LIBR(landlock_allow_rules)(int rsfd,
+                                const struct landlock_rule rules[], size_t n);
+
 // libr: rlimit.h
 
 #include <stddef.h>
@@ -182,6 +220,57 @@ void LIBR(rlimit_apply)(const struct rlimit_spec rlimits[], size_t len);
 #ifndef MIN
 #define MIN(a,b) ((a) < (b) ? (a) : (b))
 #endif
+
+// libr: timing.h
+
+// opt-in timing of the phases of a program's startup: with TIMING_FD set in
+// the environment (to an inherited file descriptor) timing_phase marks the end
+// of a phase (with CLOCK_MONOTONIC) and a JSON record of the phases' durations
+// is written to the descriptor at exit (or by timing_write, say before an exec)
+void LIBR(timing_init)(const char* prog, const char* version);
+void LIBR(timing_phase)(const char* phase);
+void LIBR(timing_write)(void);
+
+// libr: warm.h
+
+// a warm process has done the costly parts of its initialization before
+// getting its job over a socket: the job's command line and the descriptors
+// to use as its stdin, stdout, stderr and working directory
+#define WARM_FDS 4
+#define WARM_ARGC_MAX 128
+#define WARM_ARGS_MAX 4096
+
+struct warm_job {
+    int argc;
+    char* argv[WARM_ARGC_MAX + 1];
+    int fds[WARM_FDS];
+    char buf[WARM_ARGS_MAX];
+};
+
+// parse the -W FD option's argument (returns -1 if it isn't a descriptor)
+int LIBR(warm_parse_fd)(const char* str);
+
+// returns -1 if the peer has gone away (errno = EPIPE) or the command line
+// doesn't fit (errno = E2BIG), 0 otherwise
+int LIBR(warm_send)(int sock, int argc, char* const argv[], const int fds[WARM_FDS]);
+
+// returns -1 if the peer has gone away (errno = EPIPE) or sent a malformed
+// job (errno = EBADMSG, its descriptors closed), 0 otherwise
+int LIBR(warm_recv)(int sock, struct warm_job* job);
+
+// tell the supervisor on sock that this process is ready and wait for its
+// job: then make the job's descriptors this process's stdin, stdout, stderr
+// and working directory, close sock and reset getopt (for parsing the
+// job's command line)
+//
+// NB: landlock (and seccomp without TSYNC) restricts the calling thread only,
+// so a warm process mustn't have started any other threads yet
+void LIBR(warm_wait)(int sock, struct warm_job* job);
+
+// as warm_wait, but for a process that has started threads after restricting
+// itself with a sandbox that doesn't depend on the job: the job's sandbox
+// then restricts the calling thread (and the threads it starts) only
+void LIBR(warm_wait_sandboxed)(int sock, struct warm_job* job);
 #endif // LIBR_HEADER
 
 #ifdef LIBR_IMPLEMENTATION
@@ -213,6 +302,7 @@ API void LIBR(failwith0)(
     }
     va_end(vl);
 
+    LIBR(logger_flush)();
     abort();
 }
 
@@ -229,6 +319,256 @@ API void LIBR(dummy)(int foo, ...)
 
 int LIBR(logger_fd) API = 2;
 
+#if LOG_BUFFER_SIZE > 0
+
+#include <errno.h>
+#include <pthread.h>
+#include <sys/uio.h>
+#include <time.h>
+
+struct LIBR(log_buffer) {
+    pthread_mutex_t lock;
+    struct LIBR(log_buffer)* next;
+    time_t t;
+    char stamp[17];
+    size_t len;
+    char buf[LOG_BUFFER_SIZE];
+};
+
+static struct {
+    pthread_mutex_t lock;
+    pthread_once_t once;
+    pthread_key_t key;
+    struct LIBR(log_buffer)* buffers;
+    pid_t pid;
+    int exiting;
+} LIBR(logging) = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .once = PTHREAD_ONCE_INIT,
+};
+
+static __thread struct LIBR(log_buffer)* LIBR(log_buffer_current);
+
+static void LIBR(log_write)(struct iovec* iov, int n)
+{
+    while(n > 0) {
+        ssize_t r = writev(LIBR(logger_fd), iov, n);
+        if(r < 0) {
+            if(errno == EINTR) continue;
+            abort();
+        }
+
+        for(; n > 0 && (size_t)r >= iov->iov_len; iov++, n--) {
+            r -= iov->iov_len;
+        }
+        if(n > 0) {
+            iov->iov_base = (char*)iov->iov_base + r;
+            iov->iov_len -= r;
+        }
+    }
+}
+
+static void LIBR(log_flush_locked)(struct LIBR(log_buffer)* b)
+{
+    struct iovec iov;
+    iov.iov_base = b->buf;
+    iov.iov_len = b->len;
+    LIBR(log_write)(&iov, 1);
+    b->len = 0;
+}
+
+API void LIBR(logger_flush)(void)
+{
+    pthread_mutex_lock(&LIBR(logging).lock);
+
+    // batch the threads' buffers into as few writes as possible
+    struct LIBR(log_buffer)* b = LIBR(logging).buffers;
+    while(b) {
+        struct LIBR(log_buffer)* bs[16];
+        struct iovec iov[16];
+        int n = 0;
+        for(; b && n < 16; b = b->next, n++) {
+            pthread_mutex_lock(&b->lock);
+            bs[n] = b;
+            iov[n].iov_base = b->buf;
+            iov[n].iov_len = b->len;
+        }
+
+        LIBR(log_write)(iov, n);
+
+        for(int i = 0; i < n; i++) {
+            bs[i]->len = 0;
+            pthread_mutex_unlock(&bs[i]->lock);
+        }
+    }
+
+    pthread_mutex_unlock(&LIBR(logging).lock);
+}
+
+static void LIBR(log_atexit)(void)
+{
+    // messages logged by later atexit handlers and destructors are written
+    // immediately
+    __atomic_store_n(&LIBR(logging).exiting, 1, __ATOMIC_RELAXED);
+    LIBR(logger_flush)();
+}
+
+static void LIBR(log_atfork_child)(void)
+{
+    // the child starts out with copies of the parent's buffers: drop them
+    // (and the locks possibly held by the parent's other threads)
+    LIBR(logging).pid = getpid();
+    pthread_mutex_init(&LIBR(logging).lock, NULL);
+    for(struct LIBR(log_buffer)* b = LIBR(logging).buffers; b; b = b->next) {
+        pthread_mutex_init(&b->lock, NULL);
+        b->len = 0;
+    }
+}
+
+static void LIBR(log_thread_exit)(void* p)
+{
+    struct LIBR(log_buffer)* b = (struct LIBR(log_buffer)*)p;
+
+    pthread_mutex_lock(&LIBR(logging).lock);
+    for(struct LIBR(log_buffer)** q = &LIBR(logging).buffers; *q; q = &(*q)->next) {
+        if(*q == b) {
+            *q = b->next;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&LIBR(logging).lock);
+
+    pthread_mutex_lock(&b->lock);
+    LIBR(log_flush_locked)(b);
+    pthread_mutex_unlock(&b->lock);
+
+    pthread_mutex_destroy(&b->lock);
+    free(b);
+    LIBR(log_buffer_current) = NULL;
+}
+
+static void LIBR(log_init)(void)
+{
+    LIBR(logging).pid = getpid();
+    if(pthread_key_create(&LIBR(logging).key, LIBR(log_thread_exit)) != 0) {
+        abort();
+    }
+    if(pthread_atfork(LIBR(logger_flush), NULL, LIBR(log_atfork_child)) != 0) {
+        abort();
+    }
+    if(atexit(LIBR(log_atexit)) != 0) {
+        abort();
+    }
+}
+
+static struct LIBR(log_buffer)* LIBR(log_buffer)(void)
+{
+    struct LIBR(log_buffer)* b = LIBR(log_buffer_current);
+    if(b) return b;
+
+    if(pthread_once(&LIBR(logging).once, LIBR(log_init)) != 0) {
+        abort();
+    }
+
+    b = (struct LIBR(log_buffer)*)calloc(1, sizeof(*b));
+    if(b == NULL) abort();
+    pthread_mutex_init(&b->lock, NULL);
+
+    pthread_mutex_lock(&LIBR(logging).lock);
+    b->next = LIBR(logging).buffers;
+    LIBR(logging).buffers = b;
+    pthread_mutex_unlock(&LIBR(logging).lock);
+
+    if(pthread_setspecific(LIBR(logging).key, b) != 0) {
+        abort();
+    }
+
+    return LIBR(log_buffer_current) = b;
+}
+
+// returns the length of the formatted message, as snprintf
+static size_t LIBR(log_format)(
+    char* buf, size_t size,
+    const struct LIBR(log_buffer)* b,
+    const char* const caller,
+    const char* const file,
+    const unsigned int line,
+    const char* const fmt, va_list vl)
+{
+    int h = snprintf(buf, size, "%s:%d:%s:%s:%u ",
+        b->stamp, LIBR(logging).pid, caller, file, line);
+    if(h < 0) abort();
+
+    size_t o = (size_t)h < size ? (size_t)h : size;
+    int m = vsnprintf(buf + o, size - o, fmt, vl);
+    if(m < 0) abort();
+
+    return h + m;
+}
+
+API void LIBR(vlogger)(
+    int level,
+    const char* const caller,
+    const char* const file,
+    const unsigned int line,
+    const char* const fmt, va_list vl)
+{
+    struct LIBR(log_buffer)* b = LIBR(log_buffer)();
+    pthread_mutex_lock(&b->lock);
+
+    // the timestamp is formatted once a second
+    const time_t t = time(NULL);
+    if(t != b->t) {
+        LIBR(log_flush_locked)(b);
+
+        struct tm tm;
+        if(gmtime_r(&t, &tm) == NULL) abort();
+        size_t r = strftime(b->stamp, sizeof(b->stamp), "%Y%m%dT%H%M%SZ", &tm);
+        if(r <= 0) abort();
+        b->t = t;
+    }
+
+    va_list ap;
+    va_copy(ap, vl);
+    size_t n = LIBR(log_format)(b->buf + b->len, sizeof(b->buf) - b->len,
+        b, caller, file, line, fmt, ap);
+    va_end(ap);
+
+    if(b->len + n >= sizeof(b->buf)) {
+        LIBR(log_flush_locked)(b);
+
+        va_copy(ap, vl);
+        n = LIBR(log_format)(b->buf, sizeof(b->buf),
+            b, caller, file, line, fmt, ap);
+        va_end(ap);
+
+        if(n >= sizeof(b->buf)) {
+            // too long to be buffered
+            int r = dprintf(LIBR(logger_fd), "%s:%d:%s:%s:%u ",
+                b->stamp, LIBR(logging).pid, caller, file, line);
+            if(r < 0) abort();
+            r = vdprintf(LIBR(logger_fd), fmt, vl);
+            if(r < 0) abort();
+
+            pthread_mutex_unlock(&b->lock);
+            return;
+        }
+    }
+    b->len += n;
+
+    if(level <= LOG_WARNING || __atomic_load_n(&LIBR(logging).exiting, __ATOMIC_RELAXED)) {
+        LIBR(log_flush_locked)(b);
+    }
+
+    pthread_mutex_unlock(&b->lock);
+}
+
+#else
+
+API void LIBR(logger_flush)(void)
+{
+}
+
 API void LIBR(vlogger)(
     int level,
     const char* const caller,
@@ -248,6 +588,8 @@ API void LIBR(vlogger)(
     }
 }
 
+#endif
+
 API void LIBR(logger)(
     int level,
     const char* const caller,
@@ -301,6 +643,12 @@ API int LIBR(seccomp)(unsigned int operation, unsigned int flags, void *args)
 #include <unistd.h>
 #include <linux/unistd.h>
 #include <linux/landlock.h>
+#include <limits.h>
+#include <string.h>
+#include <sys/syscall.h>
+#ifdef __NR_openat2
+#include <linux/openat2.h>
+#endif
 
 #ifndef landlock_create_ruleset
 static inline int landlock_create_ruleset(
@@ -341,24 +689,27 @@ API int LIBR(landlock_abi_version)(void)
     }
 }
 
+#define LIBR_LANDLOCK_HANDLED_ACCESS_FS ( \
+      LANDLOCK_ACCESS_FS_EXECUTE \
+    | LANDLOCK_ACCESS_FS_WRITE_FILE \
+    | LANDLOCK_ACCESS_FS_READ_FILE \
+    | LANDLOCK_ACCESS_FS_READ_DIR \
+    | LANDLOCK_ACCESS_FS_REMOVE_DIR \
+    | LANDLOCK_ACCESS_FS_REMOVE_FILE \
+    | LANDLOCK_ACCESS_FS_MAKE_CHAR \
+    | LANDLOCK_ACCESS_FS_MAKE_DIR \
+    | LANDLOCK_ACCESS_FS_MAKE_REG \
+    | LANDLOCK_ACCESS_FS_MAKE_SOCK \
+    | LANDLOCK_ACCESS_FS_MAKE_FIFO \
+    | LANDLOCK_ACCESS_FS_MAKE_BLOCK \
+    | LANDLOCK_ACCESS_FS_MAKE_SYM \
+    /* TODO: | LANDLOCK_ACCESS_FS_REFER */ \
+)
+
 API int LIBR(landlock_new_ruleset)(void)
 {
     struct landlock_ruleset_attr rs = {
-        .handled_access_fs =
-              LANDLOCK_ACCESS_FS_EXECUTE
-            | LANDLOCK_ACCESS_FS_WRITE_FILE
-            | LANDLOCK_ACCESS_FS_READ_FILE
-            | LANDLOCK_ACCESS_FS_READ_DIR
-            | LANDLOCK_ACCESS_FS_REMOVE_DIR
-            | LANDLOCK_ACCESS_FS_REMOVE_FILE
-            | LANDLOCK_ACCESS_FS_MAKE_CHAR
-            | LANDLOCK_ACCESS_FS_MAKE_DIR
-            | LANDLOCK_ACCESS_FS_MAKE_REG
-            | LANDLOCK_ACCESS_FS_MAKE_SOCK
-            | LANDLOCK_ACCESS_FS_MAKE_FIFO
-            | LANDLOCK_ACCESS_FS_MAKE_BLOCK
-            | LANDLOCK_ACCESS_FS_MAKE_SYM
-            // TODO: | LANDLOCK_ACCESS_FS_REFER,
+        .handled_access_fs = LIBR_LANDLOCK_HANDLED_ACCESS_FS,
     };
 
     int rsfd = landlock_create_ruleset(&rs, sizeof(rs), 0);
@@ -367,6 +718,32 @@ API int LIBR(landlock_new_ruleset)(void)
     return rsfd;
 }
 
+API int LIBR(landlock_new_scoped_ruleset)(__u64 scoped)
+{
+    int abi = LIBR(landlock_abi_version)();
+    if(abi < LANDLOCK_ABI_SCOPE) {
+        debug("landlock ABI %d < %d: not scoped", abi, LANDLOCK_ABI_SCOPE);
+        return LIBR(landlock_new_ruleset)();
+    }
+
+    // struct landlock_ruleset_attr as of ABI 6
+    struct {
+        __u64 handled_access_fs;
+        __u64 handled_access_net;
+        __u64 scoped;
+    } rs = {
+        .handled_access_fs = LIBR_LANDLOCK_HANDLED_ACCESS_FS,
+        .handled_access_net = 0,
+        .scoped = scoped,
+    };
+
+    int rsfd = landlock_create_ruleset(
+        (const struct landlock_ruleset_attr*)&rs, sizeof(rs), 0);
+    CHECK(rsfd, "landlock_create_ruleset");
+
+    return rsfd;
+}
+
 API void LIBR(landlock_allow)(int rsfd, const char* path, __u64 allowed_access)
 {
     struct landlock_path_beneath_attr pb = {
@@ -405,6 +782,139 @@ API void LIBR(landlock_apply)(int fd)
     CHECK(r, "landlock_restrict_self");
 }
 
+// the directories leading to the previous rule's path, the root's child
+// first: a rule is resolved relative to the deepest of them that's also its
+// ancestor, saving the kernel the walk from the root
+#define LIBR_LANDLOCK_DIRS 16
+struct LIBR(landlock_dirs) {
+    char path[PATH_MAX];
+    size_t len[LIBR_LANDLOCK_DIRS];
+    int fd[LIBR_LANDLOCK_DIRS];
+    size_t depth;
+};
+
+#ifdef __NR_openat2
+static int LIBR(landlock_openat2)(int dirfd, const char* path, __u64 resolve)
+{
+    struct open_how how;
+    memset(&how, 0, sizeof(how));
+    how.flags = __O_PATH|O_CLOEXEC;
+    how.resolve = resolve;
+    return syscall(__NR_openat2, dirfd, path, &how, sizeof(how));
+}
+
+static size_t LIBR(landlock_component_end)(const char* path, size_t i)
+{
+    const char* s = strchr(path + i + 1, '/');
+    return s ? s - path : strlen(path);
+}
+
+static void LIBR(landlock_dirs_pop)(struct LIBR(landlock_dirs)* d)
+{
+    d->depth -= 1;
+    if(d->fd[d->depth] >= 0) {
+        int r = close(d->fd[d->depth]); CHECK(r, "close");
+    }
+}
+
+// the descriptor of path's directory (or -1 if it's to be opened by name)
+static int LIBR(landlock_dirs_get)(struct LIBR(landlock_dirs)* d, const char* path)
+{
+    const char* s = strrchr(path, '/');
+    size_t len = s ? s - path : 0;
+    if(path[0] != '/' || len == 0 || len >= sizeof(d->path)) {
+        return -1;
+    }
+
+    while(d->depth > 0) {
+        size_t l = d->len[d->depth - 1];
+        if(l <= len && path[l] == '/' && memcmp(d->path, path, l) == 0) {
+            break;
+        }
+        LIBR(landlock_dirs_pop)(d);
+    }
+
+    memcpy(d->path, path, len);
+    d->path[len] = '\0';
+
+    size_t l = d->depth > 0 ? d->len[d->depth - 1] : 0;
+    while(l < len) {
+        if(d->depth == LIBR_LANDLOCK_DIRS) {
+            return -1;
+        }
+
+        // NB: a failure (e.g. a symlink or a pre-5.6 kernel) is cached too:
+        // the paths beneath the directory fall back to open
+        int fd = -1;
+        if(d->depth == 0) {
+            l = LIBR(landlock_component_end)(d->path, 0);
+            d->path[l] = '\0';
+            fd = LIBR(landlock_openat2)(AT_FDCWD, d->path, RESOLVE_NO_SYMLINKS);
+        } else if(d->fd[d->depth - 1] >= 0) {
+            const char* c = d->path + l + 1;
+            l = LIBR(landlock_component_end)(d->path, l);
+            d->path[l] = '\0';
+            fd = LIBR(landlock_openat2)(d->fd[d->depth - 1], c,
+                RESOLVE_BENEATH|RESOLVE_NO_SYMLINKS);
+        } else {
+            l = LIBR(landlock_component_end)(d->path, l);
+        }
+        if(l < len) {
+            d->path[l] = '/';
+        }
+
+        d->len[d->depth] = l;
+        d->fd[d->depth] = fd;
+        d->depth += 1;
+    }
+
+    return d->fd[d->depth - 1];
+}
+#endif
+
+static int LIBR(landlock_open)(struct LIBR(landlock_dirs)* d, const char* path)
+{
+#ifdef __NR_openat2
+    int dfd = LIBR(landlock_dirs_get)(d, path);
+    if(dfd >= 0) {
+        int fd = LIBR(landlock_openat2)(dfd, strrchr(path, '/') + 1,
+            RESOLVE_BENEATH|RESOLVE_NO_SYMLINKS);
+        if(fd >= 0) {
+            return fd;
+        }
+    }
+#endif
+
+    int fd = open(path, __O_PATH|O_CLOEXEC);
+    CHECK(fd, "open(%s, O_PATH)", path);
+    return fd;
+}
+
+API void LIBR(landlock_allow_rules)(int rsfd,
+                                    const struct landlock_rule rules[], size_t n)
+{
+    struct LIBR(landlock_dirs) d = { .depth = 0 };
+
+    for(size_t i = 0; i < n; i++) {
+        struct landlock_path_beneath_attr pb = {
+            .allowed_access = rules[i].allowed_access,
+        };
+
+        pb.parent_fd = LIBR(landlock_open)(&d, rules[i].path);
+
+        int r = landlock_add_rule(rsfd, LANDLOCK_RULE_PATH_BENEATH, &pb, 0);
+        CHECK(r, "landlock_add_rule(%s)", rules[i].path);
+
+        r = close(pb.parent_fd); CHECK(r, "close(%s)", rules[i].path);
+    }
+
+#ifdef __NR_openat2
+    while(d.depth > 0) {
+        LIBR(landlock_dirs_pop)(&d);
+    }
+#endif
+}
+
 // libr: rlimit.c
 
 #include <assert.h>
@@ -597,4 +1107,309 @@ API void LIBR(rlimit_apply)(const struct rlimit_spec rlimits[], size_t len)
         CHECK(r, "setrlimit(%s)", rlimits[i].name);
     }
 }
+
+// libr: timing.c
+
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifndef TIMING_PHASES
+#define TIMING_PHASES 32
+#endif
+
+static struct {
+    int fd;
+    const char* prog;
+    const char* version;
+    struct timespec start;
+    size_t n;
+    struct {
+        const char* name;
+        struct timespec t;
+    } phases[TIMING_PHASES];
+} LIBR(timing) = { .fd = -1 };
+
+static long long LIBR(timing_ns)(const struct timespec* a, const struct timespec* b)
+{
+    return (b->tv_sec - a->tv_sec) * 1000000000LL + (b->tv_nsec - a->tv_nsec);
+}
+
+API void LIBR(timing_init)(const char* prog, const char* version)
+{
+    struct timespec start;
+    int r = clock_gettime(CLOCK_MONOTONIC, &start);
+    CHECK(r, "clock_gettime(CLOCK_MONOTONIC)");
+
+    const char* s = getenv("TIMING_FD");
+    if(s == NULL) {
+        return;
+    }
+
+    char* end;
+    long fd = strtol(s, &end, 10);
+    if(*s == '\0' || *end != '\0' || fd < 0 || fd > INT_MAX) {
+        warning("ignoring TIMING_FD: %s", s);
+        return;
+    }
+
+    // NB: don't leak it into exec:ed programs
+    r = fcntl(fd, F_SETFD, FD_CLOEXEC);
+    if(r == -1) {
+        warning("ignoring TIMING_FD: %ld: not an open file descriptor", fd);
+        return;
+    }
+
+    LIBR(timing).fd = fd;
+    LIBR(timing).prog = prog;
+    LIBR(timing).version = version;
+    LIBR(timing).start = start;
+
+    r = atexit(LIBR(timing_write));
+    CHECK_IF(r != 0, "atexit");
+}
+
+API void LIBR(timing_phase)(const char* phase)
+{
+    if(LIBR(timing).fd < 0) {
+        return;
+    }
+
+    if(LIBR(timing).n == TIMING_PHASES) {
+        warning("too many phases, ignoring: %s", phase);
+        return;
+    }
+
+    size_t i = LIBR(timing).n++;
+    LIBR(timing).phases[i].name = phase;
+    int r = clock_gettime(CLOCK_MONOTONIC, &LIBR(timing).phases[i].t);
+    CHECK(r, "clock_gettime(CLOCK_MONOTONIC)");
+}
+
+// {"prog":"hsh","version":"0.1.0","start":123,"phases":{"drop_capabilities":4,...},"total":56}
+// start is the CLOCK_MONOTONIC time of timing_init, the rest are durations,
+// all in nanoseconds
+API void LIBR(timing_write)(void)
+{
+    if(LIBR(timing).fd < 0) {
+        return;
+    }
+
+    char buf[4096];
+    size_t l = 0;
+    int r = snprintf(buf, sizeof(buf),
+        "{\"prog\":\"%s\",\"version\":\"%s\",\"start\":%lld,\"phases\":{",
+        LIBR(timing).prog, LIBR(timing).version,
+        LIBR(timing).start.tv_sec * 1000000000LL + LIBR(timing).start.tv_nsec);
+    CHECK_IF(r < 0 || (size_t)r >= sizeof(buf), "snprintf");
+    l += r;
+
+    const struct timespec* t = &LIBR(timing).start;
+    for(size_t i = 0; i < LIBR(timing).n; i++) {
+        r = snprintf(buf + l, sizeof(buf) - l, "%s\"%s\":%lld",
+            i > 0 ? "," : "", LIBR(timing).phases[i].name,
+            LIBR(timing_ns)(t, &LIBR(timing).phases[i].t));
+        CHECK_IF(r < 0 || (size_t)r >= sizeof(buf) - l, "snprintf");
+        l += r;
+        t = &LIBR(timing).phases[i].t;
+    }
+
+    r = snprintf(buf + l, sizeof(buf) - l, "},\"total\":%lld}\n",
+        LIBR(timing_ns)(&LIBR(timing).start, t));
+    CHECK_IF(r < 0 || (size_t)r >= sizeof(buf) - l, "snprintf");
+    l += r;
+
+    ssize_t w = write(LIBR(timing).fd, buf, l);
+    if(w != (ssize_t)l) {
+        warning("unable to write the timing record: %zd/%zu", w, l);
+    }
+
+    // NB: once: at exit after an explicit timing_write
+    LIBR(timing).fd = -1;
+}
+
+// libr: warm.c
+
+#include <dirent.h>
+#include <errno.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+API int LIBR(warm_parse_fd)(const char* str)
+{
+    char* end;
+    long fd = strtol(str, &end, 10);
+    if(*str == '\0' || *end != '\0' || fd < 0 || fd > INT_MAX) {
+        return -1;
+    }
+    return fd;
+}
+
+API int LIBR(warm_send)(int sock, int argc, char* const argv[], const int fds[WARM_FDS])
+{
+    char buf[WARM_ARGS_MAX];
+    size_t len = 0;
+    if(argc > WARM_ARGC_MAX) {
+        errno = E2BIG;
+        return -1;
+    }
+    for(int i = 0; i < argc; i++) {
+        size_t l = strlen(argv[i]) + 1;
+        if(len + l > sizeof(buf)) {
+            errno = E2BIG;
+            return -1;
+        }
+        memcpy(buf + len, argv[i], l);
+        len += l;
+    }
+
+    struct iovec iov = { .iov_base = buf, .iov_len = len };
+    union {
+        char buf[CMSG_SPACE(sizeof(int) * WARM_FDS)];
+        struct cmsghdr align;
+    } c;
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = c.buf;
+    msg.msg_controllen = sizeof(c.buf);
+
+    struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int) * WARM_FDS);
+    memcpy(CMSG_DATA(cmsg), fds, sizeof(int) * WARM_FDS);
+
+    ssize_t s = sendmsg(sock, &msg, MSG_NOSIGNAL);
+    if(s == -1 && (errno == EPIPE || errno == ECONNRESET)) {
+        return -1;
+    }
+    CHECK(s, "sendmsg");
+    if((size_t)s != len) {
+        failwith("partial sendmsg: %zd < %zu", s, len);
+    }
+
+    return 0;
+}
+
+API int LIBR(warm_recv)(int sock, struct warm_job* job)
+{
+    memset(job, 0, sizeof(*job));
+
+    struct iovec iov = { .iov_base = job->buf, .iov_len = sizeof(job->buf) };
+    union {
+        char buf[CMSG_SPACE(sizeof(int) * WARM_FDS)];
+        struct cmsghdr align;
+    } c;
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = c.buf;
+    msg.msg_controllen = sizeof(c.buf);
+
+    ssize_t s = recvmsg(sock, &msg, MSG_CMSG_CLOEXEC);
+    if(s == 0 || (s == -1 && errno == ECONNRESET)) {
+        errno = EPIPE;
+        return -1;
+    }
+    CHECK(s, "recvmsg");
+
+    struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    size_t n = 0;
+    if(cmsg != NULL
+       && cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) {
+        n = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+        if(n > WARM_FDS) n = WARM_FDS;
+        memcpy(job->fds, CMSG_DATA(cmsg), sizeof(int) * n);
+    }
+
+    int ok = n == WARM_FDS
+        && !(msg.msg_flags & (MSG_TRUNC|MSG_CTRUNC))
+        && job->buf[s-1] == '\0';
+    for(size_t i = 0; ok && i < (size_t)s; i += strlen(job->buf + i) + 1) {
+        if(job->argc == WARM_ARGC_MAX) {
+            ok = 0;
+            break;
+        }
+        job->argv[job->argc++] = job->buf + i;
+    }
+    job->argv[job->argc] = NULL;
+
+    if(!ok) {
+        for(size_t i = 0; i < n; i++) {
+            int r = close(job->fds[i]); CHECK(r, "close");
+        }
+        errno = EBADMSG;
+        return -1;
+    }
+
+    return 0;
+}
+
+static void LIBR(warm_single_threaded)(void)
+{
+    DIR* d = opendir("/proc/self/task");
+    CHECK_NOT(d, NULL, "opendir(/proc/self/task)");
+
+    int n = 0;
+    struct dirent* e;
+    while((e = readdir(d)) != NULL) {
+        if(e->d_name[0] != '.') n += 1;
+    }
+    int r = closedir(d); CHECK(r, "closedir");
+
+    if(n != 1) {
+        failwith("a warm process must be single-threaded (has %d threads)", n);
+    }
+}
+
+static void LIBR(warm_receive)(int sock, struct warm_job* job)
+{
+    ssize_t s = write(sock, "", 1);
+    CHECK(s, "write(ready)");
+
+    if(LIBR(warm_recv)(sock, job) != 0) {
+        if(errno == EBADMSG) {
+            failwith("malformed job");
+        }
+        debug("supervisor gone: exiting");
+        exit(0);
+    }
+    debug("job: argc=%d", job->argc);
+
+    // NB: what's been logged so far goes to the supervisor's stderr
+    LIBR(logger_flush)();
+
+    for(int i = 0; i < 3; i++) {
+        if(job->fds[i] == i) continue;
+        int r = dup2(job->fds[i], i); CHECK(r, "dup2(%d, %d)", job->fds[i], i);
+        r = close(job->fds[i]); CHECK(r, "close");
+    }
+
+    int r = fchdir(job->fds[3]); CHECK(r, "fchdir");
+    r = close(job->fds[3]); CHECK(r, "close");
+
+    r = close(sock); CHECK(r, "close");
+
+    optind = 0;
+}
+
+API void LIBR(warm_wait)(int sock, struct warm_job* job)
+{
+    LIBR(warm_single_threaded)();
+    LIBR(warm_receive)(sock, job);
+}
+
+API void LIBR(warm_wait_sandboxed)(int sock, struct warm_job* job)
+{
+    LIBR(warm_receive)(sock, job);
+}
 #endif // LIBR_IMPLEMENTATION
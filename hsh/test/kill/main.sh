@@ -0,0 +1,11 @@
+check() {
+    if kill -0 "$2"; then
+        echo "$1: allowed"
+    else
+        echo "$1: denied"
+    fi
+}
+
+check self $$
+check group 0
+check everyone -1
@@ -0,0 +1,2 @@
+type -t cat cut head
+head -n 1 "$0"
@@ -0,0 +1,9 @@
+echo hello | while read -r x; do echo "$x world"; done
+
+x=$(echo substituted)
+echo "$x"
+
+(exit 3) || echo "subshell: $?"
+
+f() { while read -r a b; do echo "$b $a"; done; }
+printf '%s\n' "1 one" "2 two" | f | while read -r l; do echo "> $l"; done
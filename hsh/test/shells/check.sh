@@ -0,0 +1,28 @@
+#!/bin/bash
+# check.sh HSH: run main.sh with each of the shells HSH was built with (as
+# listed by -h): each profile must select its shell (busybox's applet by
+# argv[0]) and be sandboxed
+
+set -o nounset -o pipefail -o errexit
+
+EXPECTED=$'main.sh\ndenied'
+
+SHELLS=$("$1" -h | sed -n '/^shells:$/,$p' | tail -n+2 | awk '{ print $1 }')
+if [ -z "$SHELLS" ]; then
+    echo "no shells" >&2
+    exit 1
+fi
+
+RESULT=0
+for s in $SHELLS; do
+    CODE=0
+    OUT=$("$1" -s "$s" main.sh) || CODE=$?
+    if [ "$CODE" != 0 ]; then
+        echo "$s: exited with $CODE" >&2
+        RESULT=1
+    elif [ "$OUT" != "$EXPECTED" ]; then
+        echo "$s: unexpected output: $OUT" >&2
+        RESULT=1
+    fi
+done
+exit $RESULT
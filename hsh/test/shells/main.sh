@@ -0,0 +1,2 @@
+echo "$0"
+if read -r l < test.toml; then echo "allowed"; else echo "denied"; fi
@@ -0,0 +1 @@
+( read -r x < test.toml && echo "$x" ) || echo denied
@@ -0,0 +1,4 @@
+f=$TMPDIR/hsh-tmpdir-test
+echo "written to TMPDIR" > "$f"
+read -r x < "$f"
+echo "$x"
@@ -0,0 +1,53 @@
+#!/bin/bash
+# burst.sh HSUP HOST exec|warm: run JOBS (default 200) jobs of HOST's (hsh,
+# hlua, hpython or hnode, the in-tree one if it's been built) script,
+# PARALLEL (default 8) at a time, and print the time it took as
+# {"burst": seconds}
+
+set -o nounset -o pipefail -o errexit
+
+HSUP=$1
+HOST=$2
+MODE=$3
+JOBS=${JOBS-200}
+PARALLEL=${PARALLEL-8}
+
+if [ -x "../../../$HOST/$HOST" ]; then
+    EXE=$(readlink -f "../../../$HOST/$HOST")
+else
+    EXE=$(command -v "$HOST")
+fi
+
+case "$HOST" in
+    hsh) SCRIPT=main.sh ;;
+    hlua) SCRIPT=main.lua ;;
+    hpython) SCRIPT=main.py ;;
+    hnode) SCRIPT=main.js ;;
+    *) echo "unknown host: $HOST" >&2; exit 2 ;;
+esac
+
+if [ "$MODE" = "warm" ]; then
+    TMP=$(mktemp -d)
+    SOCK=$TMP/sock
+
+    "$HSUP" -s "$SOCK" -p "$HOST:$PARALLEL=$EXE" &
+    SUP=$!
+    trap 'kill $SUP; wait $SUP || true; rm -rf "$TMP"' EXIT
+
+    until [ -S "$SOCK" ]; do
+        kill -0 $SUP
+        sleep 0.01
+    done
+    # let the pool fill up
+    sleep 1
+
+    CMD=("$HSUP" -c "$SOCK" "$HOST")
+else
+    CMD=("$EXE")
+fi
+
+START=$(date +%s%N)
+seq "$JOBS" | xargs -P "$PARALLEL" -I{} "${CMD[@]}" "$SCRIPT" > /dev/null
+END=$(date +%s%N)
+
+echo "{\"burst\": $((END - START))e-9}"
@@ -0,0 +1,749 @@
+#define _GNU_SOURCE // SO_PEERCRED
+
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+
+#define LIBR_IMPLEMENTATION
+#include "r.h"
+
+#define POOLS_MAX 16
+#define POOL_SIZE_DEFAULT 4
+#define POOL_SIZE_MAX 256
+#define POOL_ARGS_MAX 32
+#define WORKERS_MAX 1024
+#define CONNS_MAX 512
+
+// the number of times in a row a pool's workers may exit before becoming
+// ready until it's considered broken (and its jobs rejected)
+#define POOL_RETRIES 3
+
+// the supervisor's reply to a job is its wait status, or this if the job
+// couldn't be run
+#define JOB_REJECTED (-1)
+
+struct pool {
+    const char* name;
+    size_t size;
+
+    // the host's path and its arguments, passed to the warm processes
+    // (after -W FD) and to their jobs (before the job's arguments)
+    int argc;
+    char* argv[POOL_ARGS_MAX + 3];
+
+    size_t warm; // workers started or ready but without a job
+    int failures;
+};
+
+enum worker_state {
+    WORKER_FREE = 0,
+    WORKER_STARTING,
+    WORKER_READY,
+    // running its job, or gone: awaiting to be reaped
+    WORKER_RUNNING,
+};
+
+struct worker {
+    enum worker_state state;
+    pid_t pid;
+    int sock;
+    struct pool* pool;
+    struct conn* conn;
+};
+
+enum conn_state {
+    CONN_FREE = 0,
+    CONN_RECEIVING,
+    CONN_PENDING,
+    CONN_RUNNING,
+};
+
+struct conn {
+    enum conn_state state;
+    int fd;
+    unsigned long seq;
+    struct pool* pool;
+    struct worker* worker;
+    struct warm_job job;
+};
+
+struct options {
+    const char* socket;
+    int client;
+
+    struct pool pools[POOLS_MAX];
+    size_t n_pools;
+
+    int argc;
+    char** argv;
+};
+
+static struct state {
+    struct options* o;
+
+    int listen;
+    int sfd;
+
+    struct worker workers[WORKERS_MAX];
+    struct conn conns[CONNS_MAX];
+    unsigned long seq;
+} state;
+
+static void print_usage(int fd, const char* prog)
+{
+    dprintf(fd, "usage: %s [OPTION]... -s SOCKET -p POOL...\n", prog);
+    dprintf(fd, "       %s -c SOCKET NAME [ARG]...\n", prog);
+    dprintf(fd, "\n");
+    dprintf(fd, "options:\n");
+    dprintf(fd, "  -s SOCKET  accept jobs on the unix socket SOCKET\n");
+    dprintf(fd, "  -p NAME[:N]=PATH[,ARG]...\n");
+    dprintf(fd, "             keep N (default %d) warm PATH -W FD [ARG]... processes\n", POOL_SIZE_DEFAULT);
+    dprintf(fd, "             for the jobs sent to NAME\n");
+    dprintf(fd, "  -c SOCKET  run the job NAME [ARG]... by the supervisor on SOCKET\n");
+    dprintf(fd, "             and exit with its exit status\n");
+    dprintf(fd, "  -h         print this message\n");
+    dprintf(fd, "  -v         print version information\n");
+}
+
+#include "version.c"
+
+static void parse_pool(struct pool* p, char* spec)
+{
+    char* eq = strchr(spec, '=');
+    if(eq == NULL || eq == spec || eq[1] == '\0') {
+        dprintf(2, "error: invalid pool (expected NAME[:N]=PATH[,ARG]...): %s\n", spec);
+        exit(1);
+    }
+    *eq = '\0';
+
+    p->name = spec;
+    p->size = POOL_SIZE_DEFAULT;
+    char* colon = strchr(spec, ':');
+    if(colon != NULL) {
+        *colon = '\0';
+        char* end;
+        long n = strtol(colon + 1, &end, 10);
+        if(colon[1] == '\0' || *end != '\0' || n < 1 || n > POOL_SIZE_MAX) {
+            dprintf(2, "error: invalid pool size (1-%d): %s\n", POOL_SIZE_MAX, colon + 1);
+            exit(1);
+        }
+        p->size = n;
+    }
+
+    p->argc = 0;
+    for(char* a = strtok(eq + 1, ","); a; a = strtok(NULL, ",")) {
+        if(p->argc == POOL_ARGS_MAX + 1) {
+            dprintf(2, "error: too many arguments: > %d\n", POOL_ARGS_MAX);
+            exit(1);
+        }
+        p->argv[p->argc++] = a;
+    }
+
+    debug("pool %s: size=%zu path=%s", p->name, p->size, p->argv[0]);
+}
+
+static void parse_options(struct options* o, int argc, char* argv[])
+{
+    memset(o, 0, sizeof(*o));
+
+    int res;
+    while((res = getopt(argc, argv, "+hvs:p:c:")) != -1) {
+        switch(res) {
+        case 's':
+            o->socket = optarg;
+            break;
+        case 'c':
+            o->socket = optarg;
+            o->client = 1;
+            break;
+        case 'p':
+            if(o->n_pools == POOLS_MAX) {
+                dprintf(2, "error: too many pools: > %d\n", POOLS_MAX);
+                exit(1);
+            }
+            parse_pool(&o->pools[o->n_pools++], optarg);
+            break;
+        case 'v':
+            print_version(argv[0]);
+            exit(0);
+        case 'h':
+        default:
+            print_usage(res == 'h' ? 1 : 2, argv[0]);
+            exit(res == 'h' ? 0 : 1);
+        }
+    }
+
+    if(o->socket == NULL) {
+        dprintf(2, "error: no socket specified\n");
+        print_usage(2, argv[0]);
+        exit(1);
+    }
+
+    if(o->client) {
+        if(optind == argc) {
+            dprintf(2, "error: no job specified\n");
+            print_usage(2, argv[0]);
+            exit(1);
+        }
+        if(o->n_pools > 0) {
+            dprintf(2, "error: a client has no pools\n");
+            exit(1);
+        }
+        o->argc = argc - optind;
+        o->argv = argv + optind;
+    } else if(optind < argc) {
+        dprintf(2, "error: unexpected argument: %s\n", argv[optind]);
+        exit(1);
+    } else if(o->n_pools == 0) {
+        dprintf(2, "error: no pools specified\n");
+        print_usage(2, argv[0]);
+        exit(1);
+    }
+
+    for(size_t i = 0; i < o->n_pools; i++) {
+        for(size_t j = 0; j < i; j++) {
+            if(strcmp(o->pools[i].name, o->pools[j].name) == 0) {
+                dprintf(2, "error: duplicate pool: %s\n", o->pools[i].name);
+                exit(1);
+            }
+        }
+    }
+}
+
+static struct sockaddr_un socket_address(const char* path)
+{
+    struct sockaddr_un a;
+    memset(&a, 0, sizeof(a));
+    a.sun_family = AF_UNIX;
+    if(strlen(path) >= sizeof(a.sun_path)) {
+        dprintf(2, "error: socket path too long: %s\n", path);
+        exit(1);
+    }
+    strcpy(a.sun_path, path);
+    return a;
+}
+
+static int client(const struct options* o)
+{
+    int sock = socket(AF_UNIX, SOCK_SEQPACKET|SOCK_CLOEXEC, 0);
+    CHECK(sock, "socket");
+
+    struct sockaddr_un a = socket_address(o->socket);
+    int r = connect(sock, (struct sockaddr*)&a, sizeof(a));
+    CHECK(r, "connect(%s)", o->socket);
+
+    int cwd = open(".", O_RDONLY|O_DIRECTORY|O_CLOEXEC);
+    CHECK(cwd, "open(.)");
+
+    int fds[WARM_FDS] = { 0, 1, 2, cwd };
+    if(warm_send(sock, o->argc, o->argv, fds) != 0) {
+        if(errno == E2BIG) {
+            dprintf(2, "error: job's command line too long\n");
+        } else {
+            dprintf(2, "error: supervisor gone\n");
+        }
+        return 1;
+    }
+
+    r = close(cwd); CHECK(r, "close");
+
+    int status;
+    ssize_t s = recv(sock, &status, sizeof(status), 0);
+    CHECK(s, "recv");
+    if(s != sizeof(status)) {
+        dprintf(2, "error: supervisor gone\n");
+        return 1;
+    }
+    debug("job status: %d", status);
+
+    if(status == JOB_REJECTED) {
+        dprintf(2, "error: job rejected: %s\n", o->argv[0]);
+        return 1;
+    }
+    if(WIFEXITED(status)) {
+        return WEXITSTATUS(status);
+    }
+    if(WIFSIGNALED(status)) {
+        return 128 + WTERMSIG(status);
+    }
+    failwith("unexpected wait status: %d", status);
+}
+
+static void reply(struct conn* c, int status)
+{
+    ssize_t s = send(c->fd, &status, sizeof(status), MSG_NOSIGNAL);
+    if(s == -1 && (errno == EPIPE || errno == ECONNRESET)) {
+        debug("client gone: %d", c->fd);
+    } else {
+        CHECK(s, "send");
+    }
+}
+
+static void conn_close(struct conn* c)
+{
+    if(c->state == CONN_PENDING) {
+        for(int i = 0; i < WARM_FDS; i++) {
+            int r = close(c->job.fds[i]); CHECK(r, "close");
+        }
+    }
+    if(c->worker) {
+        c->worker->conn = NULL;
+    }
+
+    int r = close(c->fd); CHECK(r, "close");
+    c->state = CONN_FREE;
+}
+
+static void spawn(struct pool* p)
+{
+    struct worker* w = NULL;
+    for(size_t i = 0; i < LENGTH(state.workers); i++) {
+        if(state.workers[i].state == WORKER_FREE) {
+            w = &state.workers[i];
+            break;
+        }
+    }
+    if(w == NULL) {
+        warning("too many workers: > %d", WORKERS_MAX);
+        return;
+    }
+
+    int sv[2];
+    int r = socketpair(AF_UNIX, SOCK_SEQPACKET|SOCK_CLOEXEC, 0, sv);
+    CHECK(r, "socketpair");
+
+    pid_t pid = fork(); CHECK(pid, "fork");
+    if(pid == 0) {
+        sigset_t none;
+        sigemptyset(&none);
+        r = sigprocmask(SIG_SETMASK, &none, NULL); CHECK(r, "sigprocmask");
+
+        // a job and the processes it starts are killed together
+        r = setpgid(0, 0); CHECK(r, "setpgid");
+
+        // the worker's end survives the exec (unlike everything else)
+        int fd = 3;
+        if(sv[1] == fd) {
+            r = fcntl(fd, F_SETFD, 0); CHECK(r, "fcntl(F_SETFD)");
+        } else {
+            r = dup2(sv[1], fd); CHECK(r, "dup2");
+        }
+
+        char* argv[POOL_ARGS_MAX + 3];
+        argv[0] = p->argv[0];
+        argv[1] = "-W3";
+        for(int i = 1; i < p->argc; i++) {
+            argv[i+1] = p->argv[i];
+        }
+        argv[p->argc + 1] = NULL;
+
+        execv(argv[0], argv);
+        CHECK(-1, "execv(%s)", argv[0]);
+    }
+
+    r = setpgid(pid, pid);
+    if(r == -1 && errno != EACCES) {
+        CHECK(r, "setpgid(%d)", pid);
+    }
+    r = close(sv[1]); CHECK(r, "close");
+
+    debug("spawned %s worker: %d", p->name, pid);
+    w->state = WORKER_STARTING;
+    w->pid = pid;
+    w->sock = sv[0];
+    w->pool = p;
+    w->conn = NULL;
+    p->warm += 1;
+}
+
+static void fill(struct pool* p)
+{
+    if(p->failures >= POOL_RETRIES) {
+        return;
+    }
+    while(p->warm < p->size) {
+        size_t warm = p->warm;
+        spawn(p);
+        if(p->warm == warm) break;
+    }
+}
+
+static struct worker* ready_worker(const struct pool* p)
+{
+    for(size_t i = 0; i < LENGTH(state.workers); i++) {
+        struct worker* w = &state.workers[i];
+        if(w->state == WORKER_READY && w->pool == p) {
+            return w;
+        }
+    }
+    return NULL;
+}
+
+static struct conn* next_pending(const struct pool* p)
+{
+    struct conn* c = NULL;
+    for(size_t i = 0; i < LENGTH(state.conns); i++) {
+        struct conn* d = &state.conns[i];
+        if(d->state == CONN_PENDING && d->pool == p
+           && (c == NULL || d->seq < c->seq)) {
+            c = d;
+        }
+    }
+    return c;
+}
+
+static void worker_detach(struct worker* w)
+{
+    if(w->sock >= 0) {
+        int r = close(w->sock); CHECK(r, "close");
+        w->sock = -1;
+    }
+    w->pool->warm -= 1;
+    w->state = WORKER_RUNNING;
+}
+
+// hand the pool's pending jobs to its ready workers, oldest job first
+static void dispatch(struct pool* p)
+{
+    struct conn* c;
+    struct worker* w;
+    while((c = next_pending(p)) != NULL && (w = ready_worker(p)) != NULL) {
+        // the job's command line is the pool's followed by the job's
+        // arguments (i.e. without the pool's name)
+        char* argv[POOL_ARGS_MAX + WARM_ARGC_MAX + 2];
+        int argc = 0;
+        for(int i = 0; i < p->argc; i++) {
+            argv[argc++] = p->argv[i];
+        }
+        for(int i = 1; i < c->job.argc; i++) {
+            argv[argc++] = c->job.argv[i];
+        }
+        argv[argc] = NULL;
+
+        if(warm_send(w->sock, argc, argv, c->job.fds) != 0) {
+            if(errno == E2BIG) {
+                warning("%s job %lu: command line too long", p->name, c->seq);
+                reply(c, JOB_REJECTED);
+                conn_close(c);
+            } else {
+                warning("%s worker gone: %d", p->name, w->pid);
+                worker_detach(w);
+            }
+            continue;
+        }
+        debug("%s job %lu: worker %d", p->name, c->seq, w->pid);
+
+        for(int i = 0; i < WARM_FDS; i++) {
+            int r = close(c->job.fds[i]); CHECK(r, "close");
+        }
+        worker_detach(w);
+        w->conn = c;
+        c->worker = w;
+        c->state = CONN_RUNNING;
+    }
+
+    fill(p);
+
+    if(p->failures >= POOL_RETRIES && p->warm == 0) {
+        while((c = next_pending(p)) != NULL) {
+            reply(c, JOB_REJECTED);
+            conn_close(c);
+        }
+    }
+}
+
+static struct pool* find_pool(const char* name)
+{
+    for(size_t i = 0; i < state.o->n_pools; i++) {
+        if(strcmp(state.o->pools[i].name, name) == 0) {
+            return &state.o->pools[i];
+        }
+    }
+    return NULL;
+}
+
+static void accept_conn(void)
+{
+    int fd = accept(state.listen, NULL, NULL);
+    if(fd == -1 && (errno == EAGAIN || errno == ECONNABORTED)) {
+        return;
+    }
+    CHECK(fd, "accept");
+    // NB: not inherited by the workers (nor is anything else)
+    int r = fcntl(fd, F_SETFD, FD_CLOEXEC); CHECK(r, "fcntl(F_SETFD)");
+
+    // only the supervisor's user may submit jobs (to be run as that user)
+    struct ucred cred;
+    socklen_t len = sizeof(cred);
+    r = getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &cred, &len);
+    CHECK(r, "getsockopt(SO_PEERCRED)");
+    if(cred.uid != geteuid()) {
+        warning("rejecting connection: pid=%d uid=%d", cred.pid, cred.uid);
+        r = close(fd); CHECK(r, "close");
+        return;
+    }
+
+    for(size_t i = 0; i < LENGTH(state.conns); i++) {
+        struct conn* c = &state.conns[i];
+        if(c->state == CONN_FREE) {
+            c->state = CONN_RECEIVING;
+            c->fd = fd;
+            c->pool = NULL;
+            c->worker = NULL;
+            return;
+        }
+    }
+
+    warning("too many connections: > %d", CONNS_MAX);
+    r = close(fd); CHECK(r, "close");
+}
+
+static void receive_job(struct conn* c)
+{
+    if(warm_recv(c->fd, &c->job) != 0) {
+        if(errno == EBADMSG) {
+            warning("malformed job");
+        }
+        conn_close(c);
+        return;
+    }
+    c->state = CONN_PENDING;
+    c->seq = state.seq++;
+
+    c->pool = c->job.argc > 0 ? find_pool(c->job.argv[0]) : NULL;
+    if(c->pool == NULL) {
+        warning("job for unknown pool: %s", c->job.argc > 0 ? c->job.argv[0] : "");
+        reply(c, JOB_REJECTED);
+        conn_close(c);
+        return;
+    }
+    debug("%s job %lu: argc=%d", c->pool->name, c->seq, c->job.argc);
+
+    dispatch(c->pool);
+}
+
+static void worker_ready(struct worker* w)
+{
+    char b;
+    ssize_t s = recv(w->sock, &b, 1, 0);
+    if(s == -1 && errno == ECONNRESET) s = 0;
+    CHECK(s, "recv");
+    if(s == 0) {
+        // it's counted as failed when it's reaped
+        int r = close(w->sock); CHECK(r, "close");
+        w->sock = -1;
+        return;
+    }
+
+    debug("%s worker ready: %d", w->pool->name, w->pid);
+    w->state = WORKER_READY;
+    w->pool->failures = 0;
+    dispatch(w->pool);
+}
+
+static struct worker* find_worker(pid_t pid)
+{
+    for(size_t i = 0; i < LENGTH(state.workers); i++) {
+        if(state.workers[i].state != WORKER_FREE && state.workers[i].pid == pid) {
+            return &state.workers[i];
+        }
+    }
+    return NULL;
+}
+
+static void reap(void)
+{
+    while(1) {
+        int status;
+        pid_t pid = waitpid(-1, &status, WNOHANG);
+        if(pid == 0 || (pid == -1 && errno == ECHILD)) {
+            return;
+        }
+        CHECK(pid, "waitpid");
+
+        struct worker* w = find_worker(pid);
+        if(w == NULL) {
+            continue;
+        }
+
+        if(w->state == WORKER_STARTING) {
+            warning("%s worker exited before becoming ready: %d (status %d)",
+                    w->pool->name, pid, status);
+            w->pool->failures += 1;
+            worker_detach(w);
+        } else if(w->state == WORKER_READY) {
+            warning("%s worker exited while waiting: %d (status %d)",
+                    w->pool->name, pid, status);
+            worker_detach(w);
+        } else if(w->conn != NULL) {
+            debug("%s job %lu: status %d", w->pool->name, w->conn->seq, status);
+            reply(w->conn, status);
+            w->conn->worker = NULL;
+            conn_close(w->conn);
+        }
+
+        // and whatever the job left behind
+        int r = kill(-pid, SIGKILL);
+        if(r == -1 && errno != ESRCH) {
+            CHECK(r, "kill(-%d)", pid);
+        }
+
+        struct pool* p = w->pool;
+        w->state = WORKER_FREE;
+        dispatch(p);
+    }
+}
+
+static void terminate(void)
+{
+    for(size_t i = 0; i < LENGTH(state.workers); i++) {
+        struct worker* w = &state.workers[i];
+        if(w->state != WORKER_FREE) {
+            int r = kill(-w->pid, SIGKILL);
+            if(r == -1 && errno == ESRCH) continue;
+            CHECK(r, "kill(-%d)", w->pid);
+        }
+    }
+
+    int r = unlink(state.o->socket); CHECK(r, "unlink(%s)", state.o->socket);
+}
+
+static int handle_signals(void)
+{
+    struct signalfd_siginfo si;
+    ssize_t s = read(state.sfd, &si, sizeof(si));
+    CHECK(s, "read(signalfd)");
+    if(s != sizeof(si)) {
+        failwith("partial read(signalfd): %zd", s);
+    }
+
+    if(si.ssi_signo == SIGCHLD) {
+        reap();
+        return 0;
+    }
+
+    info("terminating: %s", strsignal(si.ssi_signo));
+    return 1;
+}
+
+static void supervise(struct options* o)
+{
+    state.o = o;
+
+    sigset_t sigs;
+    sigemptyset(&sigs);
+    sigaddset(&sigs, SIGCHLD);
+    sigaddset(&sigs, SIGINT);
+    sigaddset(&sigs, SIGTERM);
+    int r = sigprocmask(SIG_BLOCK, &sigs, NULL); CHECK(r, "sigprocmask");
+    state.sfd = signalfd(-1, &sigs, SFD_CLOEXEC);
+    CHECK(state.sfd, "signalfd");
+
+    state.listen = socket(AF_UNIX, SOCK_SEQPACKET|SOCK_CLOEXEC|SOCK_NONBLOCK, 0);
+    CHECK(state.listen, "socket");
+    struct sockaddr_un a = socket_address(o->socket);
+    mode_t m = umask(0177); // i.e. the socket's mode is 0600
+    r = bind(state.listen, (struct sockaddr*)&a, sizeof(a));
+    CHECK(r, "bind(%s)", o->socket);
+    umask(m);
+    r = listen(state.listen, SOMAXCONN); CHECK(r, "listen");
+    info("listening: %s", o->socket);
+
+    for(size_t i = 0; i < o->n_pools; i++) {
+        fill(&o->pools[i]);
+    }
+
+    static struct pollfd fds[2 + WORKERS_MAX + CONNS_MAX];
+    static void* owners[LENGTH(fds)];
+    while(1) {
+        nfds_t n = 0;
+        fds[n] = (struct pollfd) { .fd = state.sfd, .events = POLLIN };
+        owners[n++] = NULL;
+        fds[n] = (struct pollfd) { .fd = state.listen, .events = POLLIN };
+        owners[n++] = NULL;
+
+        // starting workers report when they're ready
+        for(size_t i = 0; i < LENGTH(state.workers); i++) {
+            struct worker* w = &state.workers[i];
+            if(w->state == WORKER_STARTING && w->sock >= 0) {
+                fds[n] = (struct pollfd) { .fd = w->sock, .events = POLLIN };
+                owners[n++] = w;
+            }
+        }
+
+        // connections send their job, or hang up (a running job's worker
+        // is then killed)
+        for(size_t i = 0; i < LENGTH(state.conns); i++) {
+            struct conn* c = &state.conns[i];
+            if(c->state != CONN_FREE) {
+                fds[n] = (struct pollfd) {
+                    .fd = c->fd,
+                    .events = c->state == CONN_RECEIVING ? POLLIN : 0,
+                };
+                owners[n++] = c;
+            }
+        }
+
+        r = poll(fds, n, -1);
+        if(r == -1 && errno == EINTR) continue;
+        CHECK(r, "poll");
+
+        if(fds[0].revents & POLLIN) {
+            if(handle_signals()) break;
+            // the signal handling may have changed the state
+            continue;
+        }
+
+        if(fds[1].revents & POLLIN) {
+            accept_conn();
+        }
+
+        for(nfds_t i = 2; i < n; i++) {
+            if(fds[i].revents == 0) continue;
+
+            struct worker* w = owners[i];
+            if(w >= state.workers && w < state.workers + LENGTH(state.workers)) {
+                if(w->state == WORKER_STARTING) {
+                    worker_ready(w);
+                }
+                continue;
+            }
+
+            struct conn* c = owners[i];
+            if(c->state == CONN_RECEIVING) {
+                receive_job(c);
+            } else if(c->state == CONN_PENDING) {
+                debug("%s job %lu: client gone", c->pool->name, c->seq);
+                conn_close(c);
+            } else if(c->state == CONN_RUNNING) {
+                debug("%s job %lu: client gone: killing %d",
+                      c->pool->name, c->seq, c->worker->pid);
+                r = kill(-c->worker->pid, SIGKILL);
+                if(r == -1 && errno != ESRCH) {
+                    CHECK(r, "kill(-%d)", c->worker->pid);
+                }
+                conn_close(c);
+            }
+        }
+    }
+
+    terminate();
+}
+
+int main(int argc, char* argv[])
+{
+    struct options o;
+    parse_options(&o, argc, argv);
+
+    if(o.client) {
+        return client(&o);
+    }
+
+    supervise(&o);
+    return 0;
+}
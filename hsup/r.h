@@ -0,0 +1,708 @@
+// based on libr 0.5.2 (20f582ad9ea9fd35f227a0044a599a66ddbd89fc) (https://github.com/rootmos/libr.git) (2025-05-09T09:57:00+02:00)
+// modules: fail logging now util warm
+// local changes: logging buffers messages per thread, warm is a local module
+
+#ifndef LIBR_HEADER
+#define LIBR_HEADER
+
+#define LIBR(x) x
+#define PRIVATE __attribute__((visibility("hidden")))
+#define PUBLIC __attribute__((visibility("default")))
+#define API PRIVATE
+
+
+// libr: fail.h
+
+#define CHECK(res, format, ...) CHECK_NOT(res, -1, format, ##__VA_ARGS__)
+
+#define CHECK_NOT(res, err, format, ...) \
+    CHECK_IF(res == err, format, ##__VA_ARGS__)
+
+#define CHECK_IF(cond, format, ...) do { \
+    if(cond) { \
+        LIBR(failwith0)(__extension__ __FUNCTION__, __extension__ __FILE__, \
+            __extension__ __LINE__, 1, \
+            format "\n", ##__VA_ARGS__); \
+    } \
+} while(0)
+
+#define CHECK_MALLOC(x) CHECK_NOT(x, NULL, "memory allocation failed")
+#define CHECK_MMAP(x) CHECK_NOT(x, MAP_FAILED, "memory mapping failed")
+
+#define failwith(format, ...) \
+    LIBR(failwith0)(__extension__ __FUNCTION__, __extension__ __FILE__, \
+        __extension__ __LINE__, 0, format "\n", ##__VA_ARGS__)
+
+#define not_implemented() do { failwith("not implemented"); } while(0)
+
+void LIBR(failwith0)(
+    const char* const caller,
+    const char* const file,
+    const unsigned int line,
+    const int include_errno,
+    const char* const fmt, ...)
+__attribute__ ((noreturn, format (printf, 5, 6)));
+
+// libr: logging.h
+
+#include <stdarg.h>
+
+#define LOG_QUIET 0
+#define LOG_ERROR 1
+#define LOG_WARNING 2
+#define LOG_INFO 3
+#define LOG_DEBUG 4
+#define LOG_TRACE 5
+
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_INFO
+#endif
+
+extern int LIBR(logger_fd);
+
+#define __r_log(level, format, ...) do { \
+    LIBR(logger)(level, __extension__ __FUNCTION__, __extension__ __FILE__, \
+          __extension__ __LINE__, format "\n", ##__VA_ARGS__); \
+} while(0)
+
+API void LIBR(dummy)(int foo, ...);
+
+#if LOG_LEVEL >= LOG_ERROR
+#define error(format, ...) __r_log(LOG_ERROR, format, ##__VA_ARGS__)
+#else
+#define error(format, ...) do { if(0) LIBR(dummy)(0, ##__VA_ARGS__); } while(0)
+#endif
+
+#if LOG_LEVEL >= LOG_WARNING
+#define warning(format, ...) __r_log(LOG_WARNING, format, ##__VA_ARGS__)
+#else
+#define warning(format, ...) do { if(0) LIBR(dummy)(0, ##__VA_ARGS__); } while(0)
+#endif
+
+#if LOG_LEVEL >= LOG_INFO
+#define info(format, ...) __r_log(LOG_INFO, format, ##__VA_ARGS__)
+#else
+#define info(format, ...) do { if(0) LIBR(dummy)(0, ##__VA_ARGS__); } while(0)
+#endif
+
+#if LOG_LEVEL >= LOG_DEBUG
+#define debug(format, ...) __r_log(LOG_DEBUG, format, ##__VA_ARGS__)
+#else
+#define debug(format, ...) do { if(0) LIBR(dummy)(0, ##__VA_ARGS__); } while(0)
+#endif
+
+#if LOG_LEVEL >= LOG_TRACE
+#define trace(format, ...) __r_log(LOG_TRACE, format, ##__VA_ARGS__)
+#else
+#define trace(format, ...) do { if(0) LIBR(dummy)(0, ##__VA_ARGS__); } while(0)
+#endif
+
+void LIBR(logger)(
+    int level,
+    const char* const caller,
+    const char* const file,
+    const unsigned int line,
+    const char* const fmt, ...)
+__attribute__ ((format (printf, 5, 6)));
+
+void LIBR(vlogger)(
+    int level,
+    const char* const caller,
+    const char* const file,
+    const unsigned int line,
+    const char* const fmt,
+    va_list vl
+);
+
+// messages are formatted into a buffer per thread (of LOG_BUFFER_SIZE bytes,
+// 0 disables buffering) which is written when full, on the first message of
+// a new second, on messages of level LOG_WARNING and above, at thread exit
+// and at exit
+#ifndef LOG_BUFFER_SIZE
+#define LOG_BUFFER_SIZE 4096
+#endif
+
+// write the buffered messages of all threads (call before exec:ing)
+void LIBR(logger_flush)(void);
+
+// libr: now.h
+
+// returns current time formated as compact ISO8601: 20190123T182628Z
+const char* LIBR(now_iso8601_compact)(void);
+
+// libr: util.h
+
+#ifndef LENGTH
+#define LENGTH(xs) (sizeof(xs)/sizeof((xs)[0]))
+#endif
+
+#ifndef LIT
+#define LIT(x) x,sizeof(x)
+#endif
+
+#ifndef STR
+#define STR(x) x,strlen(x)
+#endif
+
+#ifndef MAX
+#define MAX(a,b) ((a) > (b) ? (a) : (b))
+#endif
+
+#ifndef MIN
+#define MIN(a,b) ((a) < (b) ? (a) : (b))
+#endif
+
+// libr: warm.h
+
+// a warm process has done the costly parts of its initialization before
+// getting its job over a socket: the job's command line and the descriptors
+// to use as its stdin, stdout, stderr and working directory
+#define WARM_FDS 4
+#define WARM_ARGC_MAX 128
+#define WARM_ARGS_MAX 4096
+
+struct warm_job {
+    int argc;
+    char* argv[WARM_ARGC_MAX + 1];
+    int fds[WARM_FDS];
+    char buf[WARM_ARGS_MAX];
+};
+
+// parse the -W FD option's argument (returns -1 if it isn't a descriptor)
+int LIBR(warm_parse_fd)(const char* str);
+
+// returns -1 if the peer has gone away (errno = EPIPE) or the command line
+// doesn't fit (errno = E2BIG), 0 otherwise
+int LIBR(warm_send)(int sock, int argc, char* const argv[], const int fds[WARM_FDS]);
+
+// returns -1 if the peer has gone away (errno = EPIPE) or sent a malformed
+// job (errno = EBADMSG, its descriptors closed), 0 otherwise
+int LIBR(warm_recv)(int sock, struct warm_job* job);
+
+// tell the supervisor on sock that this process is ready and wait for its
+// job: then make the job's descriptors this process's stdin, stdout, stderr
+// and working directory, close sock and reset getopt (for parsing the
+// job's command line)
+//
+// NB: landlock (and seccomp without TSYNC) restricts the calling thread only,
+// so a warm process mustn't have started any other threads yet
+void LIBR(warm_wait)(int sock, struct warm_job* job);
+#endif // LIBR_HEADER
+
+#ifdef LIBR_IMPLEMENTATION
+
+// libr: fail.c
+
+#include <stdlib.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+API void LIBR(failwith0)(
+    const char* const caller,
+    const char* const file,
+    const unsigned int line,
+    const int include_errno,
+    const char* const fmt, ...)
+{
+    va_list vl;
+    va_start(vl, fmt);
+
+    if(include_errno) {
+        LIBR(logger)(LOG_ERROR, caller, file, line, "(%s) ", strerror(errno));
+        if(vdprintf(LIBR(logger_fd), fmt, vl) < 0) {
+            abort();
+        }
+    } else {
+        LIBR(vlogger)(LOG_ERROR, caller, file, line, fmt, vl);
+    }
+    va_end(vl);
+
+    LIBR(logger_flush)();
+    abort();
+}
+
+// libr: logging.c
+
+#include <stdio.h>
+#include <unistd.h>
+#include <stdlib.h>
+
+API void LIBR(dummy)(int foo, ...)
+{
+    abort();
+}
+
+int LIBR(logger_fd) API = 2;
+
+#if LOG_BUFFER_SIZE > 0
+
+#include <errno.h>
+#include <pthread.h>
+#include <sys/uio.h>
+#include <time.h>
+
+struct LIBR(log_buffer) {
+    pthread_mutex_t lock;
+    struct LIBR(log_buffer)* next;
+    time_t t;
+    char stamp[17];
+    size_t len;
+    char buf[LOG_BUFFER_SIZE];
+};
+
+static struct {
+    pthread_mutex_t lock;
+    pthread_once_t once;
+    pthread_key_t key;
+    struct LIBR(log_buffer)* buffers;
+    pid_t pid;
+    int exiting;
+} LIBR(logging) = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .once = PTHREAD_ONCE_INIT,
+};
+
+static __thread struct LIBR(log_buffer)* LIBR(log_buffer_current);
+
+static void LIBR(log_write)(struct iovec* iov, int n)
+{
+    while(n > 0) {
+        ssize_t r = writev(LIBR(logger_fd), iov, n);
+        if(r < 0) {
+            if(errno == EINTR) continue;
+            abort();
+        }
+
+        for(; n > 0 && (size_t)r >= iov->iov_len; iov++, n--) {
+            r -= iov->iov_len;
+        }
+        if(n > 0) {
+            iov->iov_base = (char*)iov->iov_base + r;
+            iov->iov_len -= r;
+        }
+    }
+}
+
+static void LIBR(log_flush_locked)(struct LIBR(log_buffer)* b)
+{
+    struct iovec iov;
+    iov.iov_base = b->buf;
+    iov.iov_len = b->len;
+    LIBR(log_write)(&iov, 1);
+    b->len = 0;
+}
+
+API void LIBR(logger_flush)(void)
+{
+    pthread_mutex_lock(&LIBR(logging).lock);
+
+    // batch the threads' buffers into as few writes as possible
+    struct LIBR(log_buffer)* b = LIBR(logging).buffers;
+    while(b) {
+        struct LIBR(log_buffer)* bs[16];
+        struct iovec iov[16];
+        int n = 0;
+        for(; b && n < 16; b = b->next, n++) {
+            pthread_mutex_lock(&b->lock);
+            bs[n] = b;
+            iov[n].iov_base = b->buf;
+            iov[n].iov_len = b->len;
+        }
+
+        LIBR(log_write)(iov, n);
+
+        for(int i = 0; i < n; i++) {
+            bs[i]->len = 0;
+            pthread_mutex_unlock(&bs[i]->lock);
+        }
+    }
+
+    pthread_mutex_unlock(&LIBR(logging).lock);
+}
+
+static void LIBR(log_atexit)(void)
+{
+    // messages logged by later atexit handlers and destructors are written
+    // immediately
+    __atomic_store_n(&LIBR(logging).exiting, 1, __ATOMIC_RELAXED);
+    LIBR(logger_flush)();
+}
+
+static void LIBR(log_atfork_child)(void)
+{
+    // the child starts out with copies of the parent's buffers: drop them
+    // (and the locks possibly held by the parent's other threads)
+    LIBR(logging).pid = getpid();
+    pthread_mutex_init(&LIBR(logging).lock, NULL);
+    for(struct LIBR(log_buffer)* b = LIBR(logging).buffers; b; b = b->next) {
+        pthread_mutex_init(&b->lock, NULL);
+        b->len = 0;
+    }
+}
+
+static void LIBR(log_thread_exit)(void* p)
+{
+    struct LIBR(log_buffer)* b = (struct LIBR(log_buffer)*)p;
+
+    pthread_mutex_lock(&LIBR(logging).lock);
+    for(struct LIBR(log_buffer)** q = &LIBR(logging).buffers; *q; q = &(*q)->next) {
+        if(*q == b) {
+            *q = b->next;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&LIBR(logging).lock);
+
+    pthread_mutex_lock(&b->lock);
+    LIBR(log_flush_locked)(b);
+    pthread_mutex_unlock(&b->lock);
+
+    pthread_mutex_destroy(&b->lock);
+    free(b);
+    LIBR(log_buffer_current) = NULL;
+}
+
+static void LIBR(log_init)(void)
+{
+    LIBR(logging).pid = getpid();
+    if(pthread_key_create(&LIBR(logging).key, LIBR(log_thread_exit)) != 0) {
+        abort();
+    }
+    if(pthread_atfork(LIBR(logger_flush), NULL, LIBR(log_atfork_child)) != 0) {
+        abort();
+    }
+    if(atexit(LIBR(log_atexit)) != 0) {
+        abort();
+    }
+}
+
+static struct LIBR(log_buffer)* LIBR(log_buffer)(void)
+{
+    struct LIBR(log_buffer)* b = LIBR(log_buffer_current);
+    if(b) return b;
+
+    if(pthread_once(&LIBR(logging).once, LIBR(log_init)) != 0) {
+        abort();
+    }
+
+    b = (struct LIBR(log_buffer)*)calloc(1, sizeof(*b));
+    if(b == NULL) abort();
+    pthread_mutex_init(&b->lock, NULL);
+
+    pthread_mutex_lock(&LIBR(logging).lock);
+    b->next = LIBR(logging).buffers;
+    LIBR(logging).buffers = b;
+    pthread_mutex_unlock(&LIBR(logging).lock);
+
+    if(pthread_setspecific(LIBR(logging).key, b) != 0) {
+        abort();
+    }
+
+    return LIBR(log_buffer_current) = b;
+}
+
+// returns the length of the formatted message, as snprintf
+static size_t LIBR(log_format)(
+    char* buf, size_t size,
+    const struct LIBR(log_buffer)* b,
+    const char* const caller,
+    const char* const file,
+    const unsigned int line,
+    const char* const fmt, va_list vl)
+{
+    int h = snprintf(buf, size, "%s:%d:%s:%s:%u ",
+        b->stamp, LIBR(logging).pid, caller, file, line);
+    if(h < 0) abort();
+
+    size_t o = (size_t)h < size ? (size_t)h : size;
+    int m = vsnprintf(buf + o, size - o, fmt, vl);
+    if(m < 0) abort();
+
+    return h + m;
+}
+
+API void LIBR(vlogger)(
+    int level,
+    const char* const caller,
+    const char* const file,
+    const unsigned int line,
+    const char* const fmt, va_list vl)
+{
+    struct LIBR(log_buffer)* b = LIBR(log_buffer)();
+    pthread_mutex_lock(&b->lock);
+
+    // the timestamp is formatted once a second
+    const time_t t = time(NULL);
+    if(t != b->t) {
+        LIBR(log_flush_locked)(b);
+
+        struct tm tm;
+        if(gmtime_r(&t, &tm) == NULL) abort();
+        size_t r = strftime(b->stamp, sizeof(b->stamp), "%Y%m%dT%H%M%SZ", &tm);
+        if(r <= 0) abort();
+        b->t = t;
+    }
+
+    va_list ap;
+    va_copy(ap, vl);
+    size_t n = LIBR(log_format)(b->buf + b->len, sizeof(b->buf) - b->len,
+        b, caller, file, line, fmt, ap);
+    va_end(ap);
+
+    if(b->len + n >= sizeof(b->buf)) {
+        LIBR(log_flush_locked)(b);
+
+        va_copy(ap, vl);
+        n = LIBR(log_format)(b->buf, sizeof(b->buf),
+            b, caller, file, line, fmt, ap);
+        va_end(ap);
+
+        if(n >= sizeof(b->buf)) {
+            // too long to be buffered
+            int r = dprintf(LIBR(logger_fd), "%s:%d:%s:%s:%u ",
+                b->stamp, LIBR(logging).pid, caller, file, line);
+            if(r < 0) abort();
+            r = vdprintf(LIBR(logger_fd), fmt, vl);
+            if(r < 0) abort();
+
+            pthread_mutex_unlock(&b->lock);
+            return;
+        }
+    }
+    b->len += n;
+
+    if(level <= LOG_WARNING || __atomic_load_n(&LIBR(logging).exiting, __ATOMIC_RELAXED)) {
+        LIBR(log_flush_locked)(b);
+    }
+
+    pthread_mutex_unlock(&b->lock);
+}
+
+#else
+
+API void LIBR(logger_flush)(void)
+{
+}
+
+API void LIBR(vlogger)(
+    int level,
+    const char* const caller,
+    const char* const file,
+    const unsigned int line,
+    const char* const fmt, va_list vl)
+{
+    int r = dprintf(LIBR(logger_fd), "%s:%d:%s:%s:%u ",
+        LIBR(now_iso8601_compact)(), getpid(), caller, file, line);
+    if(r < 0) {
+        abort();
+    }
+
+    r = vdprintf(LIBR(logger_fd), fmt, vl);
+    if(r < 0) {
+        abort();
+    }
+}
+
+#endif
+
+API void LIBR(logger)(
+    int level,
+    const char* const caller,
+    const char* const file,
+    const unsigned int line,
+    const char* const fmt, ...)
+{
+    va_list vl;
+    va_start(vl, fmt);
+    LIBR(vlogger)(level, caller, file, line, fmt, vl);
+    va_end(vl);
+}
+
+// libr: now.c
+
+#include <time.h>
+#include <stdlib.h>
+
+PRIVATE const char* LIBR(now_iso8601_compact)(void)
+{
+    static char buf[17];
+    const time_t t = time(NULL);
+    size_t r = strftime(buf, sizeof(buf), "%Y%m%dT%H%M%SZ", gmtime(&t));
+    if(r <= 0) abort();
+    return buf;
+}
+
+// libr: warm.c
+
+#include <dirent.h>
+#include <errno.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+API int LIBR(warm_parse_fd)(const char* str)
+{
+    char* end;
+    long fd = strtol(str, &end, 10);
+    if(*str == '\0' || *end != '\0' || fd < 0 || fd > INT_MAX) {
+        return -1;
+    }
+    return fd;
+}
+
+API int LIBR(warm_send)(int sock, int argc, char* const argv[], const int fds[WARM_FDS])
+{
+    char buf[WARM_ARGS_MAX];
+    size_t len = 0;
+    if(argc > WARM_ARGC_MAX) {
+        errno = E2BIG;
+        return -1;
+    }
+    for(int i = 0; i < argc; i++) {
+        size_t l = strlen(argv[i]) + 1;
+        if(len + l > sizeof(buf)) {
+            errno = E2BIG;
+            return -1;
+        }
+        memcpy(buf + len, argv[i], l);
+        len += l;
+    }
+
+    struct iovec iov = { .iov_base = buf, .iov_len = len };
+    union {
+        char buf[CMSG_SPACE(sizeof(int) * WARM_FDS)];
+        struct cmsghdr align;
+    } c;
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = c.buf;
+    msg.msg_controllen = sizeof(c.buf);
+
+    struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int) * WARM_FDS);
+    memcpy(CMSG_DATA(cmsg), fds, sizeof(int) * WARM_FDS);
+
+    ssize_t s = sendmsg(sock, &msg, MSG_NOSIGNAL);
+    if(s == -1 && (errno == EPIPE || errno == ECONNRESET)) {
+        return -1;
+    }
+    CHECK(s, "sendmsg");
+    if((size_t)s != len) {
+        failwith("partial sendmsg: %zd < %zu", s, len);
+    }
+
+    return 0;
+}
+
+API int LIBR(warm_recv)(int sock, struct warm_job* job)
+{
+    memset(job, 0, sizeof(*job));
+
+    struct iovec iov = { .iov_base = job->buf, .iov_len = sizeof(job->buf) };
+    union {
+        char buf[CMSG_SPACE(sizeof(int) * WARM_FDS)];
+        struct cmsghdr align;
+    } c;
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = c.buf;
+    msg.msg_controllen = sizeof(c.buf);
+
+    ssize_t s = recvmsg(sock, &msg, MSG_CMSG_CLOEXEC);
+    if(s == 0 || (s == -1 && errno == ECONNRESET)) {
+        errno = EPIPE;
+        return -1;
+    }
+    CHECK(s, "recvmsg");
+
+    struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    size_t n = 0;
+    if(cmsg != NULL
+       && cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) {
+        n = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+        if(n > WARM_FDS) n = WARM_FDS;
+        memcpy(job->fds, CMSG_DATA(cmsg), sizeof(int) * n);
+    }
+
+    int ok = n == WARM_FDS
+        && !(msg.msg_flags & (MSG_TRUNC|MSG_CTRUNC))
+        && job->buf[s-1] == '\0';
+    for(size_t i = 0; ok && i < (size_t)s; i += strlen(job->buf + i) + 1) {
+        if(job->argc == WARM_ARGC_MAX) {
+            ok = 0;
+            break;
+        }
+        job->argv[job->argc++] = job->buf + i;
+    }
+    job->argv[job->argc] = NULL;
+
+    if(!ok) {
+        for(size_t i = 0; i < n; i++) {
+            int r = close(job->fds[i]); CHECK(r, "close");
+        }
+        errno = EBADMSG;
+        return -1;
+    }
+
+    return 0;
+}
+
+static void LIBR(warm_single_threaded)(void)
+{
+    DIR* d = opendir("/proc/self/task");
+    CHECK_NOT(d, NULL, "opendir(/proc/self/task)");
+
+    int n = 0;
+    struct dirent* e;
+    while((e = readdir(d)) != NULL) {
+        if(e->d_name[0] != '.') n += 1;
+    }
+    int r = closedir(d); CHECK(r, "closedir");
+
+    if(n != 1) {
+        failwith("a warm process must be single-threaded (has %d threads)", n);
+    }
+}
+
+API void LIBR(warm_wait)(int sock, struct warm_job* job)
+{
+    LIBR(warm_single_threaded)();
+
+    ssize_t s = write(sock, "", 1);
+    CHECK(s, "write(ready)");
+
+    if(LIBR(warm_recv)(sock, job) != 0) {
+        if(errno == EBADMSG) {
+            failwith("malformed job");
+        }
+        debug("supervisor gone: exiting");
+        exit(0);
+    }
+    debug("job: argc=%d", job->argc);
+
+    // NB: what's been logged so far goes to the supervisor's stderr
+    LIBR(logger_flush)();
+
+    for(int i = 0; i < 3; i++) {
+        if(job->fds[i] == i) continue;
+        int r = dup2(job->fds[i], i); CHECK(r, "dup2(%d, %d)", job->fds[i], i);
+        r = close(job->fds[i]); CHECK(r, "close");
+    }
+
+    int r = fchdir(job->fds[3]); CHECK(r, "fchdir");
+    r = close(job->fds[3]); CHECK(r, "close");
+
+    r = close(sock); CHECK(r, "close");
+
+    optind = 0;
+}
+#endif // LIBR_IMPLEMENTATION
@@ -0,0 +1,15 @@
+#!/bin/bash
+# check.sh HSUP: the options the warm hnode has been initialized with can't
+# be changed by its job, which is then rejected, but the same job without
+# them is run
+
+set -o nounset -o pipefail
+
+for o in -j "-m 64" "-y 4"; do
+    CODE=0
+    # shellcheck disable=SC2086
+    ../supervise "$1" node $o main.js 2>/dev/null || CODE=$?
+    echo "$o: $CODE"
+done
+
+../supervise "$1" node main.js
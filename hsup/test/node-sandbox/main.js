@@ -0,0 +1,13 @@
+const fs = require("fs");
+
+try {
+    fs.readFileSync("test.toml");
+    console.log("sync: allowed");
+} catch(e) {
+    console.log("sync: denied");
+}
+
+// NB: read on libuv's threadpool
+fs.readFile("test.toml", (err) => {
+    console.log(err ? "async: denied" : "async: allowed");
+});